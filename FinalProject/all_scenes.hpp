@@ -15,11 +15,16 @@
 #include <raylib.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 
 #include "scene_manager.hpp"
+#include "leaderboard.hpp"
 #include "ui.hpp"
 #include "game_functions.hpp"
+#include "save_state.hpp"
+#include "autopilot.hpp"
+#include "simulation_thread.hpp"
 
 struct UiLibrary uiLibrary;
 
@@ -35,8 +40,23 @@ public:
 
     void End() override {}
 
+    std::vector<std::string> GetAssetManifest() override {
+        return {"bean.png"};
+    }
+
+    std::vector<int> GetLikelySuccessors() override {
+        return {1};
+    }
+
     void Update() override {
         if (IsKeyPressed(KEY_ENTER)) {
+            start_new_day = true;
+            if (GetSceneManager() != nullptr) {
+                GetSceneManager()->SwitchScene(1);
+            }
+        }
+        if (IsKeyPressed(KEY_C) && FileExists(AUTOSAVE_PATH.c_str())) {
+            continue_from_autosave = true;
             if (GetSceneManager() != nullptr) {
                 GetSceneManager()->SwitchScene(1);
             }
@@ -44,6 +64,7 @@ public:
         if (uiLibrary.Button(0, "Start game"))
         {
             std::cout << "Hello!" << std::endl;
+            start_new_day = true;
             if (GetSceneManager() != nullptr) {
                 GetSceneManager()->SwitchScene(1);
             }
@@ -67,6 +88,10 @@ public:
     void Draw() override {
         DrawTexturePro(bean, {counter * 16, 0, 16, 16}, {250, 250, 300, 300}, {0, 0}, 0.0f, WHITE);
         DrawText("R@Nd0M\n  cafe!", 290, 350, 60, WHITE);
+
+        if (FileExists(AUTOSAVE_PATH.c_str())) {
+            DrawText("Press 'C' to continue your saved day", 230, 560, 18, BLACK);
+        }
     }
 };
 
@@ -107,7 +132,11 @@ class LeaderboardScene : public Scene {
 
 public:
     void Begin() override {
-        std::ifstream in("leaderboard.txt");
+        // pick up results submitted by other instances of the game
+        leaderboard_store.Reload();
+
+        std::stringstream in;
+        leaderboard_store.ExportText(in, 10, true);
         top3 = "";
         leaderboard = "";
 
@@ -122,8 +151,6 @@ public:
             }
             counter++;
         }
-
-        in.close();
     }
 
     void End() override {}
@@ -152,47 +179,118 @@ public:
 
 class GameScene : public Scene {
     Texture pause;
-    float accumulator;
+
+    // the cafe ticks on its own thread while the scene is active
+    SimulationThread simulation = SimulationThread(cafe);
+
+    // key presses and releases, kept in order until the simulation takes them
+    InputPoller input;
+    std::vector<InputEvent> unsent_events;
+
+    // F1 hands the cafe to the autopilot, F2 speeds it up
+    bool autopilot_enabled = false;
+    float time_warp = 1.0f;
+
+    // F3 shows where the cafe's memory goes
+    bool memory_overlay = false;
 
 public:
     void Begin() override {
         pause = ResourceManager::GetInstance()->GetTexture("pause.png");
 
-        srand(time(0));
+        cafe.rng.seed(time(0));
 
         SetTargetFPS(FPS);
-        init_textures();
-        init_entities(registry, player, spawn_timer);
-        reserve_memory();
-        accumulator = 0;
-        day_score = 0;
-        button_name = "";
-
-        customers_not_served = 0;
-        customers_so_far = 0;
+        init_textures(cafe);
+
+        // for the memory overlay (F3), before anything is destroyed
+        track_entity_releases(cafe.registry);
+
+        if (continue_from_autosave && load_world(cafe, autosave.path)) {
+            // the loaded world is mid-day, so the next day rebuilds the level once
+            level_built = false;
+        }
+        else if (start_new_day || continue_from_autosave) {
+            if (level_built) {
+                restore_day_start(cafe.registry, day_start);
+                cafe.navigation_dirty = true;
+            }
+            else {
+                cafe.registry.clear();
+                init_entities(cafe);
+                capture_world(cafe, day_start);
+                level_built = true;
+            }
+
+            // everything made during the last day is gone
+            reset_day_memory(cafe);
+            cafe.day_score = 0;
+            cafe.button_name = "";
+
+            cafe.customers_not_served = 0;
+            cafe.customers_so_far = 0;
+        }
+
+        continue_from_autosave = false;
+        start_new_day = false;
+
+        reserve_memory(cafe);
+        input.Reset();
+        unsent_events.clear();
+
+        // save right away so the autosave always belongs to the current day
+        autosave.Save(cafe);
+        autosave.ResetTimer();
+
+        simulation.Start();
     }   
 
-    void End() override {}
+    void End() override {
+        // the other scenes read the cafe, so it has to stand still first
+        simulation.Stop();
+    }
 
-    void Update() override {
-        float delta_time = GetFrameTime();
+    std::vector<std::string> GetAssetManifest() override {
+        std::vector<std::string> manifest = game_textures;
+        manifest.push_back("pause.png");
+        return manifest;
+    }
 
-        read_player_input(registry, player);
+    std::vector<int> GetLikelySuccessors() override {
+        return {4, 5};
+    }
 
-        // Physics Step
-        accumulator += delta_time;
-        while(accumulator >= TIMESTEP)
+    void Update() override {
+        if (IsKeyPressed(KEY_F1))
         {
-            update_customers(registry);
-            affect_velocities(registry);
-            move_entities(registry);
-            handle_collisions(registry);
-            get_hot_items(registry);
-            update_timers(registry, spawn_timer);
+            autopilot_enabled = !autopilot_enabled;
+            time_warp = 1.0f;
+        }
 
-            accumulator -= TIMESTEP;
+        if (IsKeyPressed(KEY_F2) && autopilot_enabled)
+        {
+            time_warp = time_warp >= 16.0f ? 1.0f : time_warp * 4.0f;
         }
 
+        if (IsKeyPressed(KEY_F3))
+        {
+            memory_overlay = !memory_overlay;
+        }
+
+        simulation.SetAutopilot(autopilot_enabled, time_warp);
+        simulation.SetMemoryOverlay(memory_overlay);
+
+        // events that do not fit in the queue go out with the next frame
+        input.Poll(input_time(), unsent_events);
+
+        size_t sent = 0;
+        while (sent < unsent_events.size() && simulation.Send(unsent_events[sent]))
+            sent++;
+
+        unsent_events.erase(unsent_events.begin(), unsent_events.begin() + sent);
+
+        const RenderState& state = simulation.Latest();
+
         if (uiLibrary.ButtonIcon(0, {770, 30}, pause))
         {
             std::cout << "Hello!" << std::endl;
@@ -201,7 +299,7 @@ public:
             }
         }
 
-        if (button_name != "")
+        if (state.button_name != "")
         {
             if (IsKeyPressed(KEY_ENTER))
             {
@@ -213,13 +311,29 @@ public:
     }
 
     void Draw() override {
-        draw_level(registry, player);
+        const RenderState& state = simulation.Latest();
+        draw_render_state(state, simulation.Alpha(state));
 
-        if (button_name != "")
+        if (state.button_name != "")
         {
             DrawText("Press 'Enter' to End Day", 300, 550, 18, BLACK);
         }
 
+        if (autopilot_enabled)
+        {
+            DrawText(TextFormat("Autopilot x%i", int(time_warp)), 20, 20, 18, BLACK);
+        }
+
+        if (state.falling_behind)
+        {
+            DrawText(TextFormat("Slow motion %i%%", int(state.time_dilation * 100)), 20, 40, 18, RED);
+        }
+
+        if (state.show_memory)
+        {
+            draw_memory_overlay(state.memory);
+        }
+
         // DrawText(TextFormat("Orders: %04i", balls.size()), 20, 20, 20, WHITE);
         // DrawTexturePro(raylib_logo, {0, 0, 256, 256}, {logo_position.x, logo_position.y, 200, 200}, {0, 0}, 0.0f, WHITE);
     }
@@ -267,6 +381,10 @@ public:
 
     void End() override {}
 
+    std::vector<int> GetLikelySuccessors() override {
+        return {1};
+    }
+
     void Update() override {
         float delta_time = GetFrameTime();
 
@@ -283,23 +401,24 @@ public:
                 GetSceneManager()->SwitchScene(1);
             }
         }
-        if (button_name == "Next Day" || button_name == "Redo Day")
+        if (cafe.button_name == "Next Day" || cafe.button_name == "Redo Day")
         {
-            if (uiLibrary.Button(0, button_name, 250.0f))
+            if (uiLibrary.Button(0, cafe.button_name, 250.0f))
             {
-                if (button_name == "Next Day")
-                    day++;
-                
-                registry.clear();
+                if (cafe.button_name == "Next Day")
+                    cafe.day++;
+
+                // GameScene restores the level from the start-of-day snapshot
+                start_new_day = true;
 
                 if (GetSceneManager() != nullptr) {
                     GetSceneManager()->SwitchScene(1);
                 }
             }
         }
-        else if (button_name == "End Game")
+        else if (cafe.button_name == "End Game")
         {
-            if (uiLibrary.Button(0, button_name, 250.0f))
+            if (uiLibrary.Button(0, cafe.button_name, 250.0f))
             {
                 if (GetSceneManager() != nullptr) {
                     GetSceneManager()->SwitchScene(6);
@@ -309,7 +428,7 @@ public:
     }
 
     void Draw() override {
-        if (button_name == "Next Day" || button_name == "End Game")
+        if (cafe.button_name == "Next Day" || cafe.button_name == "End Game")
         {
             DrawText("Yummy!", position_x, 30, 100, BLACK);
         }
@@ -318,7 +437,7 @@ public:
             DrawText("Ermm..", position_x, 30, 100, BLACK);
         }
 
-        DrawText(TextFormat("Total Score: %04i", int(score)), 300, 150, 30, BLACK);
+        DrawText(TextFormat("Total Score: %04i", int(cafe.score)), 300, 150, 30, BLACK);
         // DrawText(TextFormat("Orders: %04i", balls.size()), 20, 20, 20, WHITE);
     }
 };
@@ -331,6 +450,10 @@ class EndGameScene : public Scene {
 public:
     void Begin() override {
         text_position = {300, 200};
+
+        // the run is over, nothing left to continue
+        autosave.Stop();
+        std::remove(AUTOSAVE_PATH.c_str());
     }   
 
     void End() override {}
@@ -357,7 +480,7 @@ public:
 
     void Draw() override {
         DrawText("Yummy!", text_position.x, text_position.y, 100, BLACK);
-        DrawText(TextFormat("Total Score: %04i", int(score)), 250, 150, 30, BLACK);
+        DrawText(TextFormat("Total Score: %04i", int(cafe.score)), 250, 150, 30, BLACK);
         DrawText("Press 'Enter' to type in your name for the leaderboard!", 150, 550, 18, BLACK);
     }
 };
@@ -419,75 +542,19 @@ public:
         }
 
         if (IsKeyPressed(KEY_ENTER)) {
-            std::ifstream in("leaderboard.txt");
-
-            std::string line;
-            std::string new_leaderboard = "";
-
-            int offset = 0;
-
-            while (getline (in, line)) {
-                // rank
-                int index0 = line.find(' ');
-                int rank = std::stoi(line.substr(0, index0-1));
-
-                if (offset == 0) {
-                    // name
-                    std::string sub = line.substr(index0 + 1);
-                    int index1 = sub.find(' ');
-
-                    // score
-                    std::string old_score = sub.substr(index1 + 1);
-
-                    try {
-                        int old_score_value = std::stoi(old_score);
-
-                        if (score > old_score_value) {
-                            std::string new_score = "";
-                            if (score < 10000)
-                                new_score += "0";
-                            if (score < 1000)
-                                new_score += "0";
-                            if (score < 100)
-                                new_score += "0";
-                            if (score < 10)
-                                new_score += "0";
-
-                            new_score += std::to_string(int(score));
-
-                            new_leaderboard += std::to_string(rank) + ". " + name + " " + new_score + "\n";
-                            offset = 1;
-                        }
-                    }
-                    catch (...) {
-                        std::string new_score = "";
-                        if (score < 10000)
-                            new_score += "0";
-                        if (score < 1000)
-                            new_score += "0";
-                        if (score < 100)
-                            new_score += "0";
-                        if (score < 10)
-                            new_score += "0";
-
-                        new_score += std::to_string(int(score));
-
-                        new_leaderboard += std::to_string(rank) + ". " + name + " " + new_score + "\n";
-                        offset = 1; 
-                    }
-                }
-                else if (rank + offset > 10)
-                    break;
-
-                new_leaderboard += std::to_string(rank+offset) + '.' + line.substr(index0) + "\n";
-            }
-
-            in.close();
+            // one appended record instead of rewriting the whole board
+            uint32_t rank = leaderboard_store.Submit(name, int(cafe.score));
+            std::cout << "Submitted " << name << " at rank " << rank << std::endl;
 
+            // keep a human-readable copy of the top 10
             std::ofstream file("leaderboard.txt");
-            file << new_leaderboard;
+            leaderboard_store.ExportText(file, 10, true);
             file.close();
 
+            // the run is over, the next game starts from the first day
+            cafe.day = 1;
+            cafe.score = 0;
+
             if (GetSceneManager() != nullptr) {
                 GetSceneManager()->SwitchScene(3);
             }
@@ -0,0 +1,187 @@
+#ifndef ALLOC_TRACKER
+#define ALLOC_TRACKER
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+// Counts heap allocations, by thread and by what was running when they were made.
+//
+// Only built in with TRACK_ALLOCATIONS defined. The global operator new is then
+// replaced by one that counts, and every allocation is charged to the innermost
+// AllocationScope on its thread (each tick system runs in one named after it).
+// Without it the scopes are empty and nothing is counted or replaced.
+// Include in one translation unit per program, like the other headers.
+
+struct AllocationCount
+{
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+const int MAX_ALLOCATION_TAGS = 64;
+
+#ifdef TRACK_ALLOCATIONS
+
+const bool tracking_allocations = true;
+
+struct AllocationTag
+{
+    const char* name;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+};
+
+AllocationTag allocation_tags[MAX_ALLOCATION_TAGS];
+std::atomic<int> allocation_tag_count{0};
+std::mutex allocation_tag_mutex;
+
+thread_local int current_allocation_tag = -1;
+thread_local AllocationCount thread_allocations = {0, 0};
+
+// Index of the tag with this name, added if it is new. -1 once the table is full
+int allocation_tag(const char* name)
+{
+    int count = allocation_tag_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(allocation_tags[i].name, name) == 0) return i;
+    }
+
+    std::lock_guard<std::mutex> lock(allocation_tag_mutex);
+
+    count = allocation_tag_count.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(allocation_tags[i].name, name) == 0) return i;
+    }
+
+    if (count == MAX_ALLOCATION_TAGS) return -1;
+
+    allocation_tags[count].name = name;
+    allocation_tag_count.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+inline void count_allocation(size_t size)
+{
+    thread_allocations.allocations++;
+    thread_allocations.bytes += size;
+
+    int tag = current_allocation_tag;
+    if (tag >= 0)
+    {
+        allocation_tags[tag].allocations.fetch_add(1, std::memory_order_relaxed);
+        allocation_tags[tag].bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    count_allocation(size);
+
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    count_allocation(size);
+
+    // aligned_alloc wants the size in whole alignments
+    size_t align = size_t(alignment);
+    void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+// memory from the replacement new comes from malloc, so free is right, but GCC warns
+// about every free of memory from new once it inlines the pair
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+// Charges the allocations made on this thread while it lives to the named tag.
+// The name has to outlive the program (a string literal, a system's name)
+class AllocationScope {
+    int previous;
+
+public:
+    explicit AllocationScope(const char* name) : previous(current_allocation_tag) {
+        current_allocation_tag = allocation_tag(name);
+    }
+
+    ~AllocationScope() {
+        current_allocation_tag = previous;
+    }
+
+    AllocationScope(const AllocationScope&) = delete;
+    void operator=(const AllocationScope&) = delete;
+};
+
+// Everything charged to the tag so far, on any thread
+AllocationCount allocations_in(const char* name)
+{
+    int tag = allocation_tag(name);
+    if (tag < 0) return {0, 0};
+
+    return {allocation_tags[tag].allocations.load(std::memory_order_relaxed),
+            allocation_tags[tag].bytes.load(std::memory_order_relaxed)};
+}
+
+// Everything allocated on the calling thread so far
+AllocationCount allocations_on_this_thread()
+{
+    return thread_allocations;
+}
+
+#else
+
+const bool tracking_allocations = false;
+
+class AllocationScope {
+public:
+    explicit AllocationScope(const char*) {}
+};
+
+inline AllocationCount allocations_in(const char*)
+{
+    return {0, 0};
+}
+
+inline AllocationCount allocations_on_this_thread()
+{
+    return {0, 0};
+}
+
+#endif
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef AUDIO_THREAD
+#define AUDIO_THREAD
+
+#include <raylib.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sound_effects.hpp"
+#include "spsc_queue.hpp"
+#include "trace.hpp"
+
+// Streams the music on a thread of its own.
+//
+// raylib decodes the MP3 as UpdateMusicStream refills the stream's buffer, so calling it
+// from the main loop charged the decoding to the frame, and a long frame let the buffer
+// run dry. The audio thread refills it on its own schedule instead. The main thread only
+// sends commands through a lock-free queue and reads back a couple of flags, and the
+// buffer holds several frames' worth of sound, so the audio thread being late now and
+// then does not crackle either.
+//
+// Sound effects are mixed here too, into a stream of their own with a short buffer so
+// an effect is heard within a couple of hundredths of a second of being fired.
+
+enum AudioCommandType
+{
+    AUDIO_PLAY,
+    AUDIO_STOP,
+    AUDIO_VOLUME,       // value: 0 to 1
+    AUDIO_SEEK          // value: seconds from the start
+};
+
+struct AudioCommand
+{
+    AudioCommandType type;
+    float value;
+};
+
+class AudioThread {
+    std::string path;
+    int buffer_frames = 0;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    SpscQueue<AudioCommand> commands = SpscQueue<AudioCommand>(64);
+    SpscQueue<SoundEffect> effects = SpscQueue<SoundEffect>(64);
+
+    // only used by the audio thread while it runs
+    const SamplePool* samples = nullptr;
+    VoicePool voices;
+    std::vector<int16_t> mixed = std::vector<int16_t>(MIX_FRAMES);
+
+    // set by the audio thread
+    std::atomic<bool> playing{false};
+    std::atomic<bool> finished{false};
+
+    void Apply(Music& music, const AudioCommand& command) {
+        switch (command.type)
+        {
+        case AUDIO_PLAY:
+            PlayMusicStream(music);
+            playing.store(true, std::memory_order_relaxed);
+            break;
+
+        case AUDIO_STOP:
+            StopMusicStream(music);
+            playing.store(false, std::memory_order_relaxed);
+            break;
+
+        case AUDIO_VOLUME:
+            SetMusicVolume(music, command.value);
+            break;
+
+        case AUDIO_SEEK:
+            SeekMusicStream(music, command.value);
+            break;
+        }
+    }
+
+    // Refills the effects stream with whatever the voices play next
+    void MixEffects(AudioStream stream) {
+        SoundEffect effect;
+        while (effects.Pop(effect))
+            voices.Start(effect);
+
+        // the stream has two halves, so at most two can be waiting for sound
+        for (int half = 0; half < 2 && IsAudioStreamProcessed(stream); half++)
+        {
+            TraceScope trace("MixEffects");
+
+            voices.Mix(*samples, mixed.data(), MIX_FRAMES);
+            UpdateAudioStream(stream, mixed.data(), MIX_FRAMES);
+        }
+    }
+
+    void Run() {
+        trace_thread_name("audio");
+
+        // a stream gets the default buffer size when it is loaded
+        AudioStream effects_stream = {};
+        if (samples)
+        {
+            SetAudioStreamBufferSizeDefault(MIX_FRAMES);
+            effects_stream = LoadAudioStream(SamplePool::SAMPLE_RATE, 16, 1);
+            PlayAudioStream(effects_stream);
+        }
+
+        SetAudioStreamBufferSizeDefault(buffer_frames);
+
+        Music music;
+        {
+            TraceScope trace("LoadMusicStream");
+            music = LoadMusicStream(path.c_str());
+        }
+
+        while (running.load(std::memory_order_acquire))
+        {
+            AudioCommand command;
+            while (commands.Pop(command))
+                Apply(music, command);
+
+            if (samples)
+                MixEffects(effects_stream);
+
+            if (IsMusicStreamPlaying(music))
+            {
+                TraceScope trace("UpdateMusicStream");
+                UpdateMusicStream(music);
+
+                // played all the way through once
+                float length = GetMusicTimeLength(music);
+                if (length > 0.0f && GetMusicTimePlayed(music) / length > 1.0f)
+                {
+                    StopMusicStream(music);
+                    playing.store(false, std::memory_order_relaxed);
+                    finished.store(true, std::memory_order_release);
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(UPDATE_INTERVAL_MS));
+        }
+
+        StopMusicStream(music);
+        UnloadMusicStream(music);
+        playing.store(false, std::memory_order_relaxed);
+
+        if (samples)
+            UnloadAudioStream(effects_stream);
+    }
+
+public:
+    // How often the thread refills the streams. Far shorter than the buffers last
+    static constexpr int UPDATE_INTERVAL_MS = 5;
+
+    // Sample frames the effects are mixed in at a time, half the effects stream's buffer
+    // (about 12 ms). Smaller cuts the delay before an effect is heard
+    static constexpr int MIX_FRAMES = 512;
+
+    ~AudioThread() {
+        Stop();
+    }
+
+    // Loads the music and starts streaming it once AUDIO_PLAY comes in. Call after
+    // InitAudioDevice. buffer_frames: sample frames in the stream's buffer,
+    // 8192 is about 11 frames at 60 FPS for 44.1 kHz music.
+    // samples: the loaded sound effects, or nullptr for none. Must not change until Stop
+    void Start(const std::string& path, const SamplePool* samples = nullptr, int buffer_frames = 8192) {
+        Stop();
+
+        this->path = path;
+        this->samples = samples;
+        this->buffer_frames = buffer_frames;
+        finished.store(false, std::memory_order_relaxed);
+
+        running.store(true, std::memory_order_release);
+        thread = std::thread(&AudioThread::Run, this);
+    }
+
+    // Stops and unloads the music. Call before CloseAudioDevice
+    void Stop() {
+        running.store(false, std::memory_order_release);
+
+        if (thread.joinable())
+            thread.join();
+
+        commands.Clear();
+        effects.Clear();
+        voices = VoicePool();
+    }
+
+    // Main thread. Returns false if the audio thread is too far behind to take it
+    bool Send(const AudioCommand& command) {
+        return commands.Push(command);
+    }
+
+    // Queue of effects to play, for the one thread that fires them (the simulation's).
+    // An effect that does not fit is dropped
+    SpscQueue<SoundEffect>& Effects() {
+        return effects;
+    }
+
+    // Main thread
+    bool IsPlaying() const {
+        return playing.load(std::memory_order_relaxed);
+    }
+
+    // Main thread. True once after the music has played to the end and stopped
+    bool TakeFinished() {
+        return finished.exchange(false, std::memory_order_acquire);
+    }
+};
+
+#endif
@@ -0,0 +1,443 @@
+#ifndef AUTOPILOT
+#define AUTOPILOT
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <string>
+#include <vector>
+
+// Bot that plays the cafe on its own, for soak tests and perf captures.
+// It plugs in where the keyboard is read: every tick Think looks at the world,
+// picks the next errand (get cup, fill machine, brew, combine, serve, collect payment),
+// walks there over the cafe grid and presses interact once the target is hot.
+// Include after game_functions.hpp.
+
+class Autopilot {
+    struct Cell
+    {
+        int x, y;
+    };
+
+    // entity the current errand interacts with (null when idle)
+    entt::entity target = entt::null;
+
+    // cell centers still to walk through; the last one is where the bot stands
+    std::vector<Vector2> path;
+
+    // counter the pitcher in hand was taken from
+    entt::entity pitcher_home = entt::null;
+
+    int errand_ticks = 0;
+
+    // give up on an errand that takes longer than this (target moved, path blocked, ...)
+    const int max_errand_ticks = int(10.0f / TIMESTEP);
+
+    const float walk_speed = 120.0f;
+    const float max_force = 200.0f;
+
+    static Cell CellOf(Vector2 position) {
+        return {int(floorf(position.x / GRID_SIZE)), int(floorf(position.y / GRID_SIZE))};
+    }
+
+    static Vector2 CenterOf(Cell cell) {
+        return {(cell.x + 0.5f) * GRID_SIZE, (cell.y + 0.5f) * GRID_SIZE};
+    }
+
+    // Plans a walk to a free cell next to the target, over the same walkable tiles
+    // customers use. False if no such cell can be reached
+    bool PlanPath(CafeWorld& world, entt::entity entity) {
+        entt::registry& registry = world.registry;
+
+        refresh_navigation(world);
+        Navigation& navigation = world.navigation;
+
+        const int columns = navigation.GetColumns();
+        const int rows = navigation.GetRows();
+
+        auto Inside = [columns, rows](Cell cell) {
+            return cell.x >= 0 && cell.y >= 0 && cell.x < columns && cell.y < rows;
+        };
+
+        std::vector<int> parent(columns * rows, -2);
+
+        Cell start = CellOf(registry.get<PositionComponent>(world.player).position);
+        if (!Inside(start)) return false;
+
+        // breadth first search from the player over free cells
+        std::queue<int> frontier;
+        frontier.push(start.y * columns + start.x);
+        parent[start.y * columns + start.x] = -1;
+
+        const int dx[4] = {1, -1, 0, 0};
+        const int dy[4] = {0, 0, 1, -1};
+
+        while (!frontier.empty())
+        {
+            int current = frontier.front();
+            frontier.pop();
+
+            for (int i = 0; i < 4; i++)
+            {
+                Cell next = {current % columns + dx[i], current / columns + dy[i]};
+                if (!navigation.IsWalkable(next.x, next.y)) continue;
+
+                int index = next.y * columns + next.x;
+                if (parent[index] != -2) continue;
+
+                parent[index] = current;
+                frontier.push(index);
+            }
+        }
+
+        // the closest reachable cell next to the target is where the bot stands
+        Cell goal = CellOf(registry.get<PositionComponent>(entity).position);
+        int stand = -1;
+        size_t shortest = 0;
+
+        for (int i = 0; i < 4; i++)
+        {
+            Cell next = {goal.x + dx[i], goal.y + dy[i]};
+            if (!Inside(next)) continue;
+
+            int index = next.y * columns + next.x;
+            if (parent[index] == -2) continue;
+
+            size_t length = 0;
+            for (int step = index; step != -1; step = parent[step])
+                length++;
+
+            if (stand == -1 || length < shortest)
+            {
+                stand = index;
+                shortest = length;
+            }
+        }
+
+        if (stand == -1) return false;
+
+        path.clear();
+        for (int step = stand; step != -1; step = parent[step])
+            path.push_back(CenterOf({step % columns, step / columns}));
+
+        std::reverse(path.begin(), path.end());
+
+        // the first cell is the one the player is already in
+        if (path.size() > 1)
+            path.erase(path.begin());
+
+        return true;
+    }
+
+    // Force that brings the player to the point, slowing down if it is the last one
+    Vector2 Steer(CafeWorld& world, Vector2 point, bool arrive) {
+        entt::registry& registry = world.registry;
+
+        Vector2 position = registry.get<PositionComponent>(world.player).position;
+        Vector2 velocity = registry.get<MoveComponent>(world.player).velocity;
+
+        Vector2 to_point = Vector2Subtract(point, position);
+        float distance = Vector2Length(to_point);
+
+        float speed = arrive ? fminf(walk_speed, distance * 4.0f) : walk_speed;
+        Vector2 desired = distance > 0 ? Vector2Scale(to_point, speed / distance) : Vector2Zero();
+
+        Vector2 force = Vector2Scale(Vector2Subtract(desired, velocity), 8.0f);
+        if (Vector2Length(force) > max_force)
+            force = Vector2Scale(Vector2Normalize(force), max_force);
+
+        return force;
+    }
+
+    // Finished drinks, cups and bits lying on a counter or in the machine
+    static entt::entity FindLyingDrink(entt::registry& registry, const std::string& name) {
+        auto drinks = registry.view<DrinkComponent>();
+        for (auto entity : drinks)
+        {
+            if (registry.get<DrinkComponent>(entity).name != name) continue;
+            if (!registry.get<InteractableComponent>(entity).isEnabled) continue;
+            if (registry.get<HoldableComponent>(entity).isHeld) continue;
+
+            return entity;
+        }
+
+        return entt::null;
+    }
+
+    static entt::entity FindStack(entt::registry& registry, const std::string& type, const std::string& ingredient) {
+        auto stacks = registry.view<StackComponent>();
+        for (auto entity : stacks)
+        {
+            if (registry.get<StackComponent>(entity).type != type) continue;
+
+            IngredientComponent* i = registry.try_get<IngredientComponent>(entity);
+            if (ingredient != "" && (!i || i->name != ingredient)) continue;
+
+            return entity;
+        }
+
+        return entt::null;
+    }
+
+    static entt::entity FindPitcher(entt::registry& registry, const std::string& name) {
+        auto pitchers = registry.view<IngredientComponent, HoldableComponent>();
+        for (auto entity : pitchers)
+        {
+            IngredientComponent& ingredient = registry.get<IngredientComponent>(entity);
+            if (!ingredient.isPitcher || ingredient.name != name) continue;
+            if (registry.get<HoldableComponent>(entity).isHeld) continue;
+
+            return entity;
+        }
+
+        return entt::null;
+    }
+
+    static entt::entity FindMachine(entt::registry& registry) {
+        auto machines = registry.view<CoffeeMachineComponent>();
+        for (auto entity : machines)
+            return entity;
+
+        return entt::null;
+    }
+
+    // A counter nothing is on, preferring the given one
+    static entt::entity FindFreeCounter(CafeWorld& world, entt::entity preferred) {
+        entt::registry& registry = world.registry;
+
+        Vector2 position = registry.get<PositionComponent>(world.player).position;
+        entt::entity closest = entt::null;
+        float closest_distance = 0;
+
+        auto tables = registry.view<TableComponent>();
+        for (auto entity : tables)
+        {
+            if (registry.try_get<DiningTableComponent>(entity)) continue;
+            if (registry.try_get<CoffeeMachineComponent>(entity)) continue;
+            if (!registry.get<InteractableComponent>(entity).isEnabled) continue;
+
+            if (entity == preferred) return entity;
+
+            float distance = Vector2Distance(position, registry.get<PositionComponent>(entity).position);
+            if (closest == entt::null || distance < closest_distance)
+            {
+                closest = entity;
+                closest_distance = distance;
+            }
+        }
+
+        return closest;
+    }
+
+    // Recipe for a drink made by combining, from the combine table
+    static bool RecipeOf(const std::string& drink, std::string& base, std::string& ingredient) {
+        for (auto& it : combine)
+        {
+            if (it.second == drink)
+            {
+                base = it.first.first;
+                ingredient = it.first.second;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // True if making the drink goes through the coffee machine
+    static bool NeedsMachine(const std::string& drink) {
+        std::string base, ingredient;
+        if (drink == "espresso") return true;
+        if (!RecipeOf(drink, base, ingredient)) return false;
+        return NeedsMachine(base);
+    }
+
+    // Next thing to pick up (with empty hands) towards the drink. Null means wait
+    static entt::entity NextFor(CafeWorld& world, const std::string& drink) {
+        entt::registry& registry = world.registry;
+
+        entt::entity lying = FindLyingDrink(registry, drink);
+        if (lying != entt::null) return lying;
+
+        if (drink == "empty") return FindStack(registry, "cup", "");
+
+        if (drink == "espresso")
+        {
+            entt::entity machine_entity = FindMachine(registry);
+            if (machine_entity == entt::null) return entt::null;
+
+            CoffeeMachineComponent& machine = registry.get<CoffeeMachineComponent>(machine_entity);
+
+            // brewing, wait for it
+            if (!FloatEquals(registry.get<TimerComponent>(machine_entity).time, 0.0f)) return entt::null;
+
+            if (machine.drink == entt::null) return NextFor(world, "empty");
+            if (!machine.hasCoffeeGrounds) return FindStack(registry, "ingredient", "coffee bean");
+            if (!machine.hasWater) return FindPitcher(registry, "water");
+
+            return entt::null;
+        }
+
+        std::string base, ingredient;
+        if (!RecipeOf(drink, base, ingredient)) return entt::null;
+
+        if (FindLyingDrink(registry, base) != entt::null) return FindPitcher(registry, ingredient);
+
+        return NextFor(world, base);
+    }
+
+    // Picks what to interact with next
+    entt::entity ChooseErrand(CafeWorld& world) {
+        entt::registry& registry = world.registry;
+
+        // orders, most impatient customer first
+        std::vector<entt::entity> ordering;
+        auto customers = registry.view<CustomerComponent>();
+        for (auto entity : customers)
+        {
+            if (registry.get<CustomerComponent>(entity).state == "Ordering")
+                ordering.push_back(entity);
+        }
+
+        std::sort(ordering.begin(), ordering.end(), [&registry](entt::entity a, entt::entity b) {
+            return registry.get<CustomerComponent>(a).patience < registry.get<CustomerComponent>(b).patience;
+        });
+
+        std::string wanted = ordering.empty() ? "" : registry.get<CustomerComponent>(ordering[0]).order;
+
+        entt::entity machine_entity = FindMachine(registry);
+        CoffeeMachineComponent* machine = machine_entity != entt::null ? registry.try_get<CoffeeMachineComponent>(machine_entity) : nullptr;
+        bool brewing = machine && !FloatEquals(registry.get<TimerComponent>(machine_entity).time, 0.0f);
+
+        entt::entity held = registry.get<HolderComponent>(world.player).held_item;
+
+        if (held != entt::null)
+        {
+            DrinkComponent* drink = registry.try_get<DrinkComponent>(held);
+            if (drink)
+            {
+                // serve whoever ordered it
+                for (entt::entity customer : ordering)
+                {
+                    if (registry.get<CustomerComponent>(customer).order == drink->name)
+                        return customer;
+                }
+
+                if (drink->name == "empty" && NeedsMachine(wanted) && machine && machine->drink == entt::null && !brewing)
+                    return machine_entity;
+
+                return FindFreeCounter(world, entt::null);
+            }
+
+            IngredientComponent& ingredient = registry.get<IngredientComponent>(held);
+
+            if (ingredient.name == "coffee bean" && machine && !machine->hasCoffeeGrounds && !brewing)
+                return machine_entity;
+
+            if (ingredient.name == "water" && NeedsMachine(wanted) && machine && !machine->hasWater && !brewing)
+                return machine_entity;
+
+            if (ingredient.isPitcher)
+            {
+                // pour into a drink that needs it
+                auto drinks = registry.view<DrinkComponent>();
+                for (auto entity : drinks)
+                {
+                    if (!registry.get<InteractableComponent>(entity).isEnabled) continue;
+                    if (registry.get<HoldableComponent>(entity).isHeld) continue;
+
+                    if (combine.find(std::make_pair(registry.get<DrinkComponent>(entity).name, ingredient.name)) != combine.end())
+                        return entity;
+                }
+            }
+
+            return FindFreeCounter(world, pitcher_home);
+        }
+
+        // collect payments first, they free up tables
+        auto payments = registry.view<MoneyComponent>();
+        for (auto entity : payments)
+            return entity;
+
+        for (entt::entity customer : ordering)
+        {
+            entt::entity ready = FindLyingDrink(registry, registry.get<CustomerComponent>(customer).order);
+            if (ready != entt::null) return ready;
+        }
+
+        if (wanted == "") return entt::null;
+
+        return NextFor(world, wanted);
+    }
+
+public:
+    // Errands finished (interact pressed on the target), for soak test reports
+    long errands_done = 0;
+
+    // Errands given up on
+    long errands_abandoned = 0;
+
+    // Forgets the current errand, e.g. when the level is rebuilt
+    void Reset() {
+        target = entt::null;
+        pitcher_home = entt::null;
+        path.clear();
+        errand_ticks = 0;
+    }
+
+    // Input for this tick, in place of the keyboard
+    PlayerInput Think(CafeWorld& world) {
+        entt::registry& registry = world.registry;
+        PlayerInput input = {Vector2Zero(), false};
+
+        // the day is over
+        if (world.button_name != "") return input;
+
+        if (target != entt::null && (!registry.valid(target) || ++errand_ticks > max_errand_ticks))
+        {
+            if (registry.valid(target)) errands_abandoned++;
+            Reset();
+        }
+
+        if (target == entt::null)
+        {
+            entt::entity next = ChooseErrand(world);
+            if (next == entt::null || !PlanPath(world, next)) return input;
+
+            target = next;
+            errand_ticks = 0;
+
+            IngredientComponent* ingredient = registry.try_get<IngredientComponent>(target);
+            if (ingredient && ingredient->isPitcher)
+                pitcher_home = registry.get<PlaceableComponent>(target).table;
+        }
+
+        Vector2 position = registry.get<PositionComponent>(world.player).position;
+
+        // walk the path; waypoints count as reached a little early so corners are cut smoothly
+        while (path.size() > 1 && Vector2Distance(position, path.front()) < GRID_SIZE * 0.3f)
+            path.erase(path.begin());
+
+        if (path.size() > 1 || Vector2Distance(position, path.front()) > 4.0f)
+        {
+            input.forces = Steer(world, path.front(), path.size() == 1);
+            return input;
+        }
+
+        // standing next to the target: turn to it, and interact once it is the hot item
+        Vector2 to_target = Vector2Subtract(registry.get<PositionComponent>(target).position, position);
+        input.forces = Vector2Scale(Vector2Normalize(to_target), 1.0f);
+
+        if (registry.get<InteractorComponent>(world.player).hot_item == target)
+        {
+            input.interact = true;
+            errands_done++;
+            target = entt::null;
+            path.clear();
+        }
+
+        return input;
+    }
+};
+
+#endif
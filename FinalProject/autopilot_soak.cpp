@@ -0,0 +1,155 @@
+/**
+ * Headless soak test
+ *
+ * Lets the autopilot play day after day as fast as the simulation runs,
+ * restarting days the same way the game does, and prints one CSV line per day.
+ * Entity counts that keep growing point at leaks; tick times that keep growing
+ * point at slowdowns. With --memory the memory the world takes up at the end of
+ * every day (ecs_inspector.hpp) is written to a JSON file as well, and with --trace
+ * the run is traced into a Chrome trace JSON file (trace.hpp).
+ *
+ * Usage: autopilot_soak [--days N] [--hours H] [--seed S] [--out soak.csv] [--memory memory.json]
+ *                       [--trace trace.json]
+ */
+
+#include <raylib.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "scene_manager.hpp"
+#include "ui.hpp"
+#include "game_functions.hpp"
+#include "save_state.hpp"
+#include "autopilot.hpp"
+#include "ecs_inspector.hpp"
+
+int main(int argc, char** argv)
+{
+    long days = 100;
+    double hours = 0;
+    unsigned seed = 1;
+    std::string out_path = "";
+    std::string memory_path = "";
+    std::string trace_path = "";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--days") == 0 && i + 1 < argc)
+            days = atol(argv[++i]);
+        else if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc)
+            hours = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = unsigned(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out_path = argv[++i];
+        else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+            memory_path = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            trace_path = argv[++i];
+        else
+        {
+            std::cout << "Usage: " << argv[0] << " [--days N] [--hours H] [--seed S] [--out soak.csv] [--memory memory.json]"
+                      << " [--trace trace.json]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream file;
+    if (out_path != "") file.open(out_path);
+    std::ostream& out = out_path != "" ? file : std::cout;
+
+    CafeWorld& world = cafe;
+    world.verbose = false;
+    world.rng.seed(seed);
+
+    Autopilot autopilot;
+    WorldSnapshot start_of_day;
+
+    track_entity_releases(world.registry);
+    init_entities(world);
+    capture_world(world, start_of_day);
+
+    // a day the autopilot cannot finish still has to stop.
+    // Spawn gaps grow towards the end of a day, so a full day takes a few times time_per_day
+    long max_ticks = long((time_per_day * 10) / TIMESTEP);
+
+    std::vector<MemoryReport> memory_reports;
+
+    trace_thread_name("main");
+    if (trace_path != "") start_tracing();
+
+    auto soak_start = std::chrono::steady_clock::now();
+
+    out << "run_day,day,result,day_score,score,ticks,entities,errands,abandoned,mean_tick_us,max_tick_us\n";
+
+    for (long run_day = 1; days <= 0 || run_day <= days; run_day++)
+    {
+        restore_day_start(world.registry, start_of_day);
+        world.navigation_dirty = true;
+        reset_day_memory(world);
+        world.day_score = 0;
+        world.button_name = "";
+        world.customers_not_served = 0;
+        world.customers_so_far = 0;
+        reserve_memory(world);
+        autopilot.Reset();
+
+        long ticks = 0;
+        double total_us = 0;
+        double max_us = 0;
+
+        while (world.button_name == "" && ticks < max_ticks)
+        {
+            TraceScope trace("tick");
+            auto tick_start = std::chrono::steady_clock::now();
+
+            apply_player_input(world, autopilot.Think(world));
+            simulate_tick(world);
+
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tick_start).count();
+            total_us += us;
+            if (us > max_us) max_us = us;
+
+            ticks++;
+        }
+
+        std::string result = world.button_name == "" ? "Timeout" : world.button_name;
+
+        out << run_day << ',' << world.day << ',' << result << ',' << world.day_score << ',' << world.score << ','
+            << ticks << ',' << world.registry.storage<PositionComponent>().size() << ','
+            << autopilot.errands_done << ',' << autopilot.errands_abandoned << ','
+            << (ticks > 0 ? total_us / ticks : 0) << ',' << max_us << std::endl;
+
+        if (memory_path != "")
+        {
+            memory_reports.emplace_back();
+            inspect_memory(world, memory_reports.back());
+
+            // rewritten every day, so a soak that gets stopped still leaves its file
+            std::ofstream memory_file(memory_path);
+            write_memory_json(memory_file, memory_reports);
+        }
+
+        // move on the way DayEndScene does, and start over once the game ends like NameEntryScene
+        if (result == "Next Day")
+            world.day++;
+        else if (result == "End Game")
+        {
+            world.day = 1;
+            world.score = 0;
+        }
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - soak_start).count();
+        if (hours > 0 && elapsed >= hours * 3600.0) break;
+    }
+
+    if (trace_path != "") stop_tracing(trace_path);
+
+    return 0;
+}
@@ -13,6 +13,11 @@ struct PositionComponent
 	Vector2 position;		// center
 };
 
+struct PreviousPositionComponent
+{
+	Vector2 position;		// center at the start of the last tick, to draw in between ticks
+};
+
 struct ColorComponent
 {
 	Color color;
@@ -21,7 +26,7 @@ struct ColorComponent
 struct SpriteComponent
 {
 	Texture sprite_sheet;
-	std::vector<Rectangle> frames;
+	std::pmr::vector<Rectangle> frames;		// in the day arena for things made during the day
 	int frame_number;
 };
 
@@ -41,6 +46,14 @@ struct PhysicsComponent
 	float inverse_mass;
 };
 
+struct StillnessComponent
+{
+	int ticks;				// ticks in a row the body has (almost) not moved
+};
+
+// the body has been still long enough to be left out of physics until something wakes it
+struct SleepingComponent {};
+
 struct DirectionComponent
 {
 	Vector2 forward;		// forward vector
@@ -120,6 +133,7 @@ struct CoffeeMachineComponent
 struct TimerComponent
 {
 	float time;
+	bool rang = false;		// ran out this tick, set by count_down_timers until resolve_timers handles it
 };
 
 struct CustomerComponent
@@ -134,4 +148,26 @@ struct CustomerComponent
 struct MoneyComponent
 {
 	float amount;
-};
\ No newline at end of file
+};
+
+// What an entity is to the player's interact key. Set when the entity is created,
+// so an interaction is dispatched from the kinds alone (see interaction_table)
+enum InteractionKind
+{
+	KIND_MONEY = 1 << 0,
+	KIND_HOLDABLE = 1 << 1,
+	KIND_STACK = 1 << 2,
+	KIND_MACHINE = 1 << 3,
+	KIND_CUSTOMER = 1 << 4,
+	KIND_TABLE = 1 << 5,
+	KIND_DRINK = 1 << 6,
+
+	// only matter for the held item
+	KIND_INGREDIENT = 1 << 7,
+	KIND_PITCHER = 1 << 8
+};
+
+struct InteractionComponent
+{
+	uint16_t kinds;			// InteractionKind bits
+};
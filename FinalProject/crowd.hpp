@@ -0,0 +1,222 @@
+#ifndef CROWD
+#define CROWD
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Local avoidance so walking agents do not pass through each other.
+//
+// Every tick the agents are loaded into a batch (structure of arrays) and
+// bucketed into a neighbour grid with a counting sort, so agents sharing a cell
+// sit next to each other in memory. Each agent is only compared with agents in
+// the 3x3 cells around it, which is O(1) per agent as long as cells are not packed.
+//
+// The separation loop runs over a whole cell of agents against one neighbour at a
+// time, with no branches, so the compiler can vectorize it.
+class Crowd {
+    int columns = 1;
+    int rows = 1;
+    float cell_size = 1.0f;
+
+    // agents sorted by cell; agents in cell c are [cell_start[c], cell_start[c + 1])
+    std::vector<uint32_t> cell_start;
+    std::vector<uint32_t> cell_of;
+    std::vector<uint32_t> cursor;
+    std::vector<uint32_t> order;
+
+    std::vector<float> sorted_x, sorted_y, sorted_radius;
+    std::vector<float> heading_x, heading_y;
+    std::vector<float> push_x, push_y;
+    std::vector<float> side_x, side_y;
+
+    int CellOf(float px, float py) const {
+        int cx = std::min(std::max(int(floorf(px / cell_size)), 0), columns - 1);
+        int cy = std::min(std::max(int(floorf(py / cell_size)), 0), rows - 1);
+        return cy * columns + cx;
+    }
+
+    void Bucket() {
+        size_t count = x.size();
+
+        cell_start.assign(columns * rows + 1, 0);
+        cell_of.resize(count);
+        order.resize(count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            cell_of[i] = CellOf(x[i], y[i]);
+            cell_start[cell_of[i] + 1]++;
+        }
+
+        for (size_t c = 1; c < cell_start.size(); c++)
+            cell_start[c] += cell_start[c - 1];
+
+        // place every agent at the next free slot of its cell
+        cursor.assign(cell_start.begin(), cell_start.end() - 1);
+
+        for (size_t i = 0; i < count; i++)
+            order[cursor[cell_of[i]]++] = uint32_t(i);
+
+        sorted_x.resize(count);
+        sorted_y.resize(count);
+        sorted_radius.resize(count);
+        heading_x.resize(count);
+        heading_y.resize(count);
+
+        for (size_t s = 0; s < count; s++)
+        {
+            uint32_t i = order[s];
+            sorted_x[s] = x[i];
+            sorted_y[s] = y[i];
+            sorted_radius[s] = radius[i];
+
+            float speed = sqrtf(vx[i] * vx[i] + vy[i] * vy[i]);
+            heading_x[s] = speed > 0 ? vx[i] / speed : 0.0f;
+            heading_y[s] = speed > 0 ? vy[i] / speed : 0.0f;
+        }
+    }
+
+public:
+    // Agent batch. Fill with Add, call Avoid, read the adjusted vx and vy back
+    std::vector<float> x, y;
+    std::vector<float> vx, vy;
+    std::vector<float> radius;
+    std::vector<uint8_t> steerable;     // 0 for agents others avoid but that keep their velocity
+
+    // extra gap agents try to keep between each other
+    float margin = 8.0f;
+
+    // how hard agents push away from each other (speed at contact)
+    float strength = 120.0f;
+
+    // how fast agents step aside for someone in front of them. They step away from
+    // the other agent's side, or to their right if it is dead ahead, so two agents
+    // walking into each other always pick opposite sides and pass
+    float sidestep = 100.0f;
+
+    // Grid the neighbour search runs on. Agents outside it are put in the closest cell.
+    // Cells have to be at least as big as two agents plus the margin
+    void SetGrid(int columns, int rows, float cell_size) {
+        this->columns = std::max(columns, 1);
+        this->rows = std::max(rows, 1);
+        this->cell_size = cell_size;
+    }
+
+    void Clear() {
+        x.clear();
+        y.clear();
+        vx.clear();
+        vy.clear();
+        radius.clear();
+        steerable.clear();
+    }
+
+    size_t Size() const {
+        return x.size();
+    }
+
+    void Add(float px, float py, float pvx, float pvy, float r, bool steer) {
+        x.push_back(px);
+        y.push_back(py);
+        vx.push_back(pvx);
+        vy.push_back(pvy);
+        radius.push_back(r);
+        steerable.push_back(steer ? 1 : 0);
+    }
+
+    // Adds separation to the velocity of every steerable agent, capped at max_speed
+    void Avoid(float max_speed) {
+        size_t count = x.size();
+        if (count == 0) return;
+
+        Bucket();
+
+        push_x.assign(count, 0.0f);
+        push_y.assign(count, 0.0f);
+        side_x.assign(count, 0.0f);
+        side_y.assign(count, 0.0f);
+
+        float* px = push_x.data();
+        float* py = push_y.data();
+        float* sx = side_x.data();
+        float* sy = side_y.data();
+        const float* ax = sorted_x.data();
+        const float* ay = sorted_y.data();
+        const float* ar = sorted_radius.data();
+        const float* hx = heading_x.data();
+        const float* hy = heading_y.data();
+
+        for (int cy = 0; cy < rows; cy++)
+        {
+            for (int cx = 0; cx < columns; cx++)
+            {
+                uint32_t begin = cell_start[cy * columns + cx];
+                uint32_t end = cell_start[cy * columns + cx + 1];
+                if (begin == end) continue;
+
+                for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, rows - 1); ny++)
+                {
+                    for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, columns - 1); nx++)
+                    {
+                        uint32_t other_begin = cell_start[ny * columns + nx];
+                        uint32_t other_end = cell_start[ny * columns + nx + 1];
+
+                        for (uint32_t j = other_begin; j < other_end; j++)
+                        {
+                            const float ox = ax[j];
+                            const float oy = ay[j];
+                            const float reach = ar[j] + margin;
+
+                            // the whole cell against one neighbour. An agent against itself
+                            // has a zero offset, so it pushes nothing
+                            for (uint32_t i = begin; i < end; i++)
+                            {
+                                float dx = ax[i] - ox;
+                                float dy = ay[i] - oy;
+                                float distance = sqrtf(dx * dx + dy * dy) + 1e-4f;
+                                float range = ar[i] + reach;
+
+                                // 1 when touching the center, 0 at the edge of the range
+                                float closeness = fmaxf(range - distance, 0.0f) / range;
+
+                                px[i] += dx / distance * closeness;
+                                py[i] += dy / distance * closeness;
+
+                                // how much the neighbour is in front of us, and which side of it we are on
+                                float ahead = fmaxf(-(hx[i] * dx + hy[i] * dy) / distance, 0.0f) * closeness;
+                                float side = copysignf(1.0f, hx[i] * dy - hy[i] * dx);
+
+                                // step along our right hand (-hy, hx), away from the neighbour
+                                sx[i] -= hy[i] * side * ahead;
+                                sy[i] += hx[i] * side * ahead;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        for (size_t s = 0; s < count; s++)
+        {
+            uint32_t i = order[s];
+            if (!steerable[i]) continue;
+
+            float nvx = vx[i] + push_x[s] * strength + side_x[s] * sidestep;
+            float nvy = vy[i] + push_y[s] * strength + side_y[s] * sidestep;
+
+            float speed = sqrtf(nvx * nvx + nvy * nvy);
+            if (speed > max_speed)
+            {
+                nvx *= max_speed / speed;
+                nvy *= max_speed / speed;
+            }
+
+            vx[i] = nvx;
+            vy[i] = nvy;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef DAY_ARENA
+#define DAY_ARENA
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+// Memory for things that only live for one day (the cups, beans and payments made
+// during it, the queue).
+//
+// Allocations bump a pointer through one block and are never freed one by one; when
+// the day is over and everything made during it is gone, Reset takes the whole block
+// back at once. A day that needs more than the block spills over onto the heap, and
+// the next day gets a block big enough for all of it.
+class DayArena {
+    // the heap, counting what the arena takes from it
+    class Spill : public std::pmr::memory_resource {
+    public:
+        size_t bytes = 0;
+
+    private:
+        void* do_allocate(size_t size, size_t alignment) override {
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+
+        void do_deallocate(void* pointer, size_t size, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(pointer, size, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    Spill spill;
+    std::unique_ptr<std::byte[]> block;
+    size_t block_size;
+    std::optional<std::pmr::monotonic_buffer_resource> arena;
+
+public:
+    explicit DayArena(size_t block_size = 64 * 1024) : block_size(block_size) {
+        block = std::make_unique<std::byte[]>(block_size);
+        arena.emplace(block.get(), block_size, &spill);
+    }
+
+    DayArena(const DayArena&) = delete;
+    void operator=(const DayArena&) = delete;
+
+    // Allocator for containers that live until the day ends. It stays the same across
+    // resets, so a container can keep it as long as it lets go of its memory before one
+    std::pmr::memory_resource* Resource() {
+        return &*arena;
+    }
+
+    // Frees everything allocated since the last reset.
+    // Nothing allocated from the arena may be used afterwards
+    void Reset() {
+        arena.reset();
+
+        if (spill.bytes > 0)
+        {
+            block_size += spill.bytes;
+            block = std::make_unique<std::byte[]>(block_size);
+            spill.bytes = 0;
+        }
+
+        arena.emplace(block.get(), block_size, &spill);
+    }
+
+    // Bytes set aside for one day without touching the heap
+    size_t BlockSize() const {
+        return block_size;
+    }
+};
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef ECS_INSPECTOR
+#define ECS_INSPECTOR
+
+#include <raylib.h>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Where the cafe's memory goes: how many of each component there are, what their
+// storages take up and what the components own on the heap besides, and how much
+// entity ids get recycled. Sampled into a MemoryReport that the game shows as an
+// overlay (F3) and the soak test writes out as JSON once per day.
+// Include after game_functions.hpp.
+
+struct StorageReport
+{
+    const char* name;
+    size_t components;
+    size_t dense_bytes;     // packed entities and components, everything allocated for them
+    size_t sparse_bytes;    // entity id to packed index
+    size_t owned_bytes;     // heap memory owned by members of the components (strings, vectors)
+};
+
+struct MemoryReport
+{
+    int day = 0;
+    std::vector<StorageReport> storages;
+
+    size_t entities_alive = 0;
+    size_t entity_ids = 0;      // ids handed out so far, alive or waiting to be reused
+    uint64_t releases = 0;      // times an id has been given back since tracking started
+
+    size_t day_arena_bytes = 0;
+
+    size_t TotalBytes() const {
+        size_t total = entity_ids * sizeof(entt::entity) + day_arena_bytes;
+        for (const StorageReport& storage : storages)
+            total += storage.dense_bytes + storage.sparse_bytes + storage.owned_bytes;
+        return total;
+    }
+};
+
+// heap memory owned by a component's members, nothing for most components
+template <typename T>
+size_t owned_bytes(const T&)
+{
+    return 0;
+}
+
+size_t owned_bytes(const std::string& string)
+{
+    // short strings live inside the string itself
+    static const size_t inline_capacity = std::string().capacity();
+    return string.capacity() > inline_capacity ? string.capacity() + 1 : 0;
+}
+
+size_t owned_bytes(const SpriteComponent& sprite)
+{
+    return sprite.frames.capacity() * sizeof(Rectangle);
+}
+
+size_t owned_bytes(const DrinkComponent& drink)
+{
+    return owned_bytes(drink.name);
+}
+
+size_t owned_bytes(const IngredientComponent& ingredient)
+{
+    return owned_bytes(ingredient.name);
+}
+
+size_t owned_bytes(const StackComponent& stack)
+{
+    return owned_bytes(stack.type);
+}
+
+size_t owned_bytes(const CustomerComponent& customer)
+{
+    return owned_bytes(customer.state) + owned_bytes(customer.order);
+}
+
+// Ids given back to a registry. Counted as they go, since the versions of recycled
+// ids wrap around after a few thousand releases
+struct EntityReleases
+{
+    uint64_t count = 0;
+};
+
+void count_entity_release(entt::registry& registry, entt::entity)
+{
+    registry.ctx().get<EntityReleases>().count++;
+}
+
+// Starts counting the ids the registry gives back, if it is not counting yet.
+// Call before the world is built to count every release
+void track_entity_releases(entt::registry& registry)
+{
+    if (registry.ctx().contains<EntityReleases>()) return;
+
+    registry.ctx().emplace<EntityReleases>();
+    registry.on_destroy<entt::entity>().connect<&count_entity_release>();
+}
+
+template <typename T>
+void inspect_storage(entt::registry& registry, const char* name, MemoryReport& report)
+{
+    auto& storage = registry.storage<T>();
+
+    // empty components (tags) only have their entities stored
+    size_t component_size = std::is_empty_v<T> ? 0 : sizeof(T);
+
+    StorageReport stats;
+    stats.name = name;
+    stats.components = storage.size();
+    stats.dense_bytes = storage.capacity() * (sizeof(entt::entity) + component_size);
+    stats.sparse_bytes = storage.extent() * sizeof(entt::entity);
+    stats.owned_bytes = 0;
+
+    if constexpr (!std::is_empty_v<T>)
+    {
+        // iterating the storage itself goes over components, its base goes over entities
+        const entt::sparse_set& entities = storage;
+        for (auto entity : entities)
+            stats.owned_bytes += owned_bytes(storage.get(entity));
+    }
+
+    report.storages.push_back(stats);
+}
+
+// Samples the world into the report. Reuses the report's memory, so sampling into
+// the same report again does not allocate
+void inspect_memory(CafeWorld& world, MemoryReport& report)
+{
+    entt::registry& registry = world.registry;
+
+    report.day = world.day;
+    report.storages.clear();
+
+    inspect_storage<CircleComponent>(registry, "Circle", report);
+    inspect_storage<SquareComponent>(registry, "Square", report);
+    inspect_storage<PositionComponent>(registry, "Position", report);
+    inspect_storage<PreviousPositionComponent>(registry, "PreviousPosition", report);
+    inspect_storage<ColorComponent>(registry, "Color", report);
+    inspect_storage<SpriteComponent>(registry, "Sprite", report);
+    inspect_storage<MoveComponent>(registry, "Move", report);
+    inspect_storage<AccelerationComponent>(registry, "Acceleration", report);
+    inspect_storage<PhysicsComponent>(registry, "Physics", report);
+    inspect_storage<StillnessComponent>(registry, "Stillness", report);
+    inspect_storage<SleepingComponent>(registry, "Sleeping", report);
+    inspect_storage<DirectionComponent>(registry, "Direction", report);
+    inspect_storage<InteractableComponent>(registry, "Interactable", report);
+    inspect_storage<InteractorComponent>(registry, "Interactor", report);
+    inspect_storage<ChairComponent>(registry, "Chair", report);
+    inspect_storage<TableComponent>(registry, "Table", report);
+    inspect_storage<DiningTableComponent>(registry, "DiningTable", report);
+    inspect_storage<PlaceableComponent>(registry, "Placeable", report);
+    inspect_storage<HoldableComponent>(registry, "Holdable", report);
+    inspect_storage<HolderComponent>(registry, "Holder", report);
+    inspect_storage<DrinkComponent>(registry, "Drink", report);
+    inspect_storage<IngredientComponent>(registry, "Ingredient", report);
+    inspect_storage<StackComponent>(registry, "Stack", report);
+    inspect_storage<CoffeeMachineComponent>(registry, "CoffeeMachine", report);
+    inspect_storage<TimerComponent>(registry, "Timer", report);
+    inspect_storage<CustomerComponent>(registry, "Customer", report);
+    inspect_storage<MoneyComponent>(registry, "Money", report);
+    inspect_storage<InteractionComponent>(registry, "Interaction", report);
+
+    auto& entities = registry.storage<entt::entity>();
+
+    report.entities_alive = entities.in_use();
+    report.entity_ids = entities.size();
+
+    // counts from here on if nothing started it sooner
+    track_entity_releases(registry);
+    report.releases = registry.ctx().get<EntityReleases>().count;
+
+    report.day_arena_bytes = world.day_arena.BlockSize();
+}
+
+// One JSON array with an object per report, for tracking memory across days
+void write_memory_json(std::ostream& out, const std::vector<MemoryReport>& reports)
+{
+    out << "[\n";
+
+    for (size_t i = 0; i < reports.size(); i++)
+    {
+        const MemoryReport& report = reports[i];
+        uint64_t churn = i > 0 ? report.releases - reports[i - 1].releases : report.releases;
+
+        out << "  {\"day\": " << report.day
+            << ", \"entities_alive\": " << report.entities_alive
+            << ", \"entity_ids\": " << report.entity_ids
+            << ", \"releases\": " << report.releases
+            << ", \"releases_since_last\": " << churn
+            << ", \"day_arena_bytes\": " << report.day_arena_bytes
+            << ", \"total_bytes\": " << report.TotalBytes()
+            << ",\n   \"storages\": {";
+
+        for (size_t j = 0; j < report.storages.size(); j++)
+        {
+            const StorageReport& storage = report.storages[j];
+
+            out << (j > 0 ? "," : "") << "\n    \"" << storage.name << "\": {"
+                << "\"components\": " << storage.components
+                << ", \"dense_bytes\": " << storage.dense_bytes
+                << ", \"sparse_bytes\": " << storage.sparse_bytes
+                << ", \"owned_bytes\": " << storage.owned_bytes << "}";
+        }
+
+        out << "}}" << (i + 1 < reports.size() ? "," : "") << "\n";
+    }
+
+    out << "]" << std::endl;
+}
+
+// Table of the report in the top left corner, storages that take up nothing left out
+void draw_memory_overlay(const MemoryReport& report)
+{
+    const int x = 20;
+    const int line = 14;
+    int y = 70;
+
+    DrawText(TextFormat("Day %i: %.1f KiB, %i entities alive of %i ids, %i ids released",
+                        report.day, report.TotalBytes() / 1024.0f, int(report.entities_alive),
+                        int(report.entity_ids), int(report.releases)), x, y, line, BLACK);
+    y += line;
+
+    DrawText(TextFormat("Day arena %.1f KiB", report.day_arena_bytes / 1024.0f), x, y, line, BLACK);
+    y += line + 4;
+
+    DrawText("storage           count   dense  sparse    heap (KiB)", x, y, line, DARKGRAY);
+    y += line;
+
+    for (const StorageReport& storage : report.storages)
+    {
+        if (storage.dense_bytes + storage.sparse_bytes + storage.owned_bytes == 0) continue;
+
+        DrawText(TextFormat("%-16s %6i %7.1f %7.1f %7.1f", storage.name, int(storage.components),
+                            storage.dense_bytes / 1024.0f, storage.sparse_bytes / 1024.0f,
+                            storage.owned_bytes / 1024.0f), x, y, line, BLACK);
+        y += line;
+    }
+}
+
+#endif
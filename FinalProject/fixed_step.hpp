@@ -0,0 +1,92 @@
+#ifndef FIXED_STEP
+#define FIXED_STEP
+
+#include <algorithm>
+#include <cmath>
+
+// Fixed-step clock for the game loop.
+// Frame time goes into an accumulator and comes out as whole simulation ticks.
+// After a hitch (window drag, asset load) only a bounded number of ticks run in
+// one frame and the rest of the backlog is dropped, so the game slows down for a
+// moment instead of stalling further every frame (the spiral of death).
+//
+// Whatever is left in the accumulator is how far the next tick has progressed,
+// which drawing uses to blend between the previous and current positions.
+class FixedStep {
+    float timestep;
+    float accumulator = 0;
+
+    // simulated time over requested time, smoothed over about a quarter of a second
+    float dilation = 1.0f;
+
+public:
+    // most ticks run in one frame at normal speed
+    int max_ticks_per_frame = 8;
+
+    // total simulated time dropped to stay responsive, for logging
+    float dropped_time = 0;
+
+    FixedStep(float timestep) : timestep(timestep) {}
+
+    void Reset() {
+        accumulator = 0;
+        dilation = 1.0f;
+        dropped_time = 0;
+    }
+
+    // Adds the frame's time and returns how many ticks to run now.
+    // time_warp multiplies both the time and the tick budget
+    int Advance(float frame_time, float time_warp = 1.0f) {
+        float requested = frame_time * time_warp;
+        accumulator += requested;
+
+        int budget = std::max(int(max_ticks_per_frame * time_warp), 1);
+        int ticks = std::min(int(accumulator / timestep), budget);
+
+        accumulator -= ticks * timestep;
+
+        // more than a tick left means we fell behind, keep only the part of a tick
+        float dropped = 0;
+        if (accumulator >= timestep)
+        {
+            dropped = accumulator - fmodf(accumulator, timestep);
+            accumulator -= dropped;
+            dropped_time += dropped;
+        }
+
+        if (requested > 0)
+        {
+            float ratio = 1.0f - dropped / requested;
+            float blend = std::min(frame_time * 4.0f, 1.0f);
+            dilation += (ratio - dilation) * blend;
+        }
+
+        return ticks;
+    }
+
+    // How far between the last tick and the next one we are, from 0 to 1
+    float Alpha() const {
+        return std::min(accumulator / timestep, 1.0f);
+    }
+
+    // Simulated seconds in the accumulator, short of a whole tick
+    float Leftover() const {
+        return accumulator;
+    }
+
+    // Seconds of frame time until the next tick is due
+    float TimeToNextTick() const {
+        return std::max(timestep - accumulator, 0.0f);
+    }
+
+    // 1 when the simulation keeps up, less while it is running in slow motion
+    float TimeDilation() const {
+        return dilation;
+    }
+
+    bool FallingBehind() const {
+        return dilation < 0.99f;
+    }
+};
+
+#endif
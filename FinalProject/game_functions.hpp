@@ -1,16 +1,32 @@
 #include <raymath.h>
+#include <cstdint>
 #include <iostream>
+#include <random>
 #include <string>
 #include <map>
+#include <memory_resource>
+#include <tuple>
 #include <vector>
 
 #include "entt.hpp"
+#include "alloc_tracker.hpp"
+#include "trace.hpp"
+#include "day_arena.hpp"
 #include "components.hpp"
-
-const float FPS = 60;
-const float TIMESTEP = 1/FPS;
+#include "navigation.hpp"
+#include "crowd.hpp"
+#include "narrowphase.hpp"
+#include "tilemap.hpp"
+#include "sound_effects.hpp"
+#include "spsc_queue.hpp"
+
+const float FPS = 60;                   // drawing rate
+const float TICK_RATE = 60;             // simulation rate, drawing interpolates in between
+const float TIMESTEP = 1/TICK_RATE;
 const float FRICTION = 1.5f;
 const float e = 0.25f;
+const float SLEEP_SPEED = 2.0f;         // bodies slower than this with nothing pushing them are still
+const int SLEEP_TICKS = 30;             // still ticks before a body falls asleep
 
 const float GRID_SIZE = 50;
 const float radius = 16.0f;
@@ -19,21 +35,7 @@ const float interact_range = GRID_SIZE * 1.5f;
 const int fail_threshold = 3;
 const float time_per_day = 180.0f;
 const float head_start_time = 15.0f;
-
-float brew_time = 15.0f;
-float consume_time = 15.0f;
-
-int day = 1;
-int total_days = 5;
-
-int customers_not_served = 0;
-float total_customers_today[6] = {0, 8, 10, 12, 15, 18};
-float customers_so_far = 0;
-
-float score = 0;
-float day_score = 0;
-
-std::string button_name = "";
+const float customer_speed = 100.0f;
 
 // TEXTURES
 Texture bean;
@@ -41,10 +43,8 @@ Texture hot_coffee;
 Texture coffee_tools;
 Texture iced_coffee;
 
-
-entt::registry registry;
-entt::entity player;
-entt::entity spawn_timer;
+// every texture init_textures loads, so the game scene can warm them ahead of time
+std::vector<std::string> game_textures = {"bean.png", "hot_coffee.png", "iced_coffee.png", "coffee_tools.png"};
 
 std::string drinks[4] = {"water", "espresso", "americano", "cappuccino"};
 int drinks_on_menu = 2;
@@ -61,26 +61,128 @@ std::map<std::string, int> price =
     {"water", 5},
     {"espresso", 8},
     {"americano", 10},
-    {"cappucino", 12},
+    {"cappuccino", 12},
 };
 
-std::vector<entt::entity> queue;
-std::vector<entt::entity> available_tables;
+// Everything one cafe needs to run.
+// The game has a single world (cafe); the balancing runner simulates many side by side
+struct CafeWorld
+{
+    // memory for the things made during the day, first so it outlives them
+    DayArena day_arena;
+
+    entt::registry registry;
+    entt::entity player;
+    entt::entity spawn_timer;
+
+    std::pmr::vector<entt::entity> queue{day_arena.Resource()};
+    std::pmr::vector<entt::entity> available_tables{day_arena.Resource()};
+
+    float brew_time = 15.0f;
+    float consume_time = 15.0f;
+
+    int day = 1;
+    int total_days = 5;
+
+    int customers_not_served = 0;
+    float total_customers_today[6] = {0, 8, 10, 12, 15, 18};
+    float customers_so_far = 0;
+
+    float score = 0;
+    float day_score = 0;
+
+    std::string button_name = "";
+
+    // customers come in and leave through here
+    Vector2 entrance = {-radius, -radius};
+
+    // Optional arrival schedule: arrival_gaps[i] is the wait between customer i + 1 and i + 2.
+    // Empty means the game's usual spread over the day
+    std::vector<float> arrival_gaps;
+
+    // flow fields customers walk along; set navigation_dirty when obstacles are added or moved
+    Navigation navigation = Navigation(int(WINDOW_WIDTH / GRID_SIZE), int(WINDOW_HEIGHT / GRID_SIZE), GRID_SIZE);
+    bool navigation_dirty = true;
+
+    // obstacles in the tiles they sit on, and the few that do not fit a tile;
+    // rebuilt along with the navigation
+    Tilemap tilemap;
+    std::vector<entt::entity> loose_obstacles;
+
+    // walking customers keep out of each other's way; crowd_agents[i] is agent i of the batch
+    Crowd crowd;
+    std::vector<entt::entity> crowd_agents;
+
+    // collision bodies of the tick; collision_bodies[i] is body i
+    Narrowphase narrowphase;
+    std::vector<entt::entity> collision_bodies;
+
+    // each world has its own random numbers, so worlds on different threads
+    // neither share raylib's generator nor depend on each other's draws
+    std::mt19937 rng;
+
+    // texture id to the file it was loaded from, for every texture sprites use. Filled by
+    // init_textures, so saving on the simulation thread never has to ask the ResourceManager
+    std::vector<std::pair<unsigned int, std::string>> texture_paths;
+
+    // print gameplay messages (turned off for headless runs)
+    bool verbose = true;
+
+    // where sound effects are fired, the audio thread's queue in the game and none for
+    // headless runs. Only the thread running the ticks may fire them
+    SpscQueue<SoundEffect>* sounds = nullptr;
+
+    // random integer in [min, max], like GetRandomValue
+    int random(int min, int max)
+    {
+        return std::uniform_int_distribution<int>(min, max)(rng);
+    }
+};
 
-void init_textures()
+CafeWorld cafe;
+
+// gameplay log, silent for worlds that are not verbose
+std::ostream& cafe_log(CafeWorld& world)
+{
+    thread_local std::ostream silent(nullptr);
+    return world.verbose ? std::cout : silent;
+}
+
+// price of a drink, 0 if it is not on the list
+int price_of(const std::string& drink)
+{
+    auto it = price.find(drink);
+    if (it == price.end()) return 0;
+    return it->second;
+}
+
+// Main thread. Also notes where each texture came from in the world, for saving sprites
+void init_textures(CafeWorld& world)
 {
-    bean = ResourceManager::GetInstance()->GetTexture("bean.png");
-    hot_coffee = ResourceManager::GetInstance()->GetTexture("hot_coffee.png");
-    iced_coffee = ResourceManager::GetInstance()->GetTexture("iced_coffe.png");
-    coffee_tools = ResourceManager::GetInstance()->GetTexture("coffee_tools.png");
+    world.texture_paths.clear();
+
+    auto load = [&world](const std::string& path) {
+        Texture texture = ResourceManager::GetInstance()->GetTexture(path);
+        world.texture_paths.push_back({texture.id, path});
+        return texture;
+    };
+
+    bean = load("bean.png");
+    hot_coffee = load("hot_coffee.png");
+    iced_coffee = load("iced_coffee.png");
+    coffee_tools = load("coffee_tools.png");
 }
 
-void init_entities(entt::registry& registry, entt::entity& player, entt::entity& spawn_timer)
+// ENTITY CREATION
+// The level and the stress scenarios (scenario.hpp) are both built from these
+
+entt::entity create_player(CafeWorld& world, Vector2 position)
 {
-    // player
-    player = registry.create();
+    entt::registry& registry = world.registry;
+
+    entt::entity player = registry.create();
     registry.emplace<CircleComponent>(player, radius);
-    registry.emplace<PositionComponent>(player, Vector2{8.5f * GRID_SIZE, 7.5f * GRID_SIZE});
+    registry.emplace<PositionComponent>(player, position);
     registry.emplace<MoveComponent>(player, Vector2Zero());
     registry.emplace<AccelerationComponent>(player, Vector2Zero());
     registry.emplace<PhysicsComponent>(player, 1.0f, 1 / 1.0f);
@@ -89,566 +191,712 @@ void init_entities(entt::registry& registry, entt::entity& player, entt::entity&
     registry.emplace<HolderComponent>(player, entt::null);
     registry.emplace<ColorComponent>(player, BLUE);
 
-    // spawn timer for customers
-    spawn_timer = registry.create();
-    registry.emplace<TimerComponent>(spawn_timer, head_start_time); // time before first customer
+    world.player = player;
+    return player;
+}
 
-//FOR TESTING
-    // counters
-    entt::entity counter1 = registry.create();
-    registry.emplace<SquareComponent>(counter1, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(counter1, Vector2{4.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(counter1, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(counter1, false, false);
-    registry.emplace<TableComponent>(counter1, true);
-    registry.emplace<ColorComponent>(counter1, DARKBROWN);
-
-    entt::entity counter2 = registry.create();
-    registry.emplace<SquareComponent>(counter2, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(counter2, Vector2{5.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(counter2, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(counter2, false, false);
-    registry.emplace<TableComponent>(counter2, true);
-    registry.emplace<ColorComponent>(counter2, DARKBROWN);
-
-    entt::entity counter3 = registry.create();
-    registry.emplace<SquareComponent>(counter3, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(counter3, Vector2{6.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(counter3, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(counter3, false, false);
-    registry.emplace<TableComponent>(counter3, true);
-    registry.emplace<ColorComponent>(counter3, DARKBROWN);
-
-    entt::entity counter4 = registry.create();
-    registry.emplace<SquareComponent>(counter4, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(counter4, Vector2{7.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(counter4, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(counter4, false, false);
-    registry.emplace<TableComponent>(counter4, true);
-    registry.emplace<ColorComponent>(counter4, DARKBROWN);
-
-    entt::entity counter5 = registry.create();
-    registry.emplace<SquareComponent>(counter5, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(counter5, Vector2{9.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(counter5, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(counter5, true, false);
-    registry.emplace<TableComponent>(counter5, true);
-    registry.emplace<ColorComponent>(counter5, DARKBROWN);
-
-    entt::entity counter6 = registry.create();
-    registry.emplace<SquareComponent>(counter6, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(counter6, Vector2{10.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(counter6, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(counter6, false, false);
-    registry.emplace<TableComponent>(counter6, true);
-    registry.emplace<ColorComponent>(counter6, DARKBROWN);
-
-    entt::entity counter7 = registry.create();
-    registry.emplace<SquareComponent>(counter7, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(counter7, Vector2{11.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(counter7, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(counter7, false, false);
-    registry.emplace<TableComponent>(counter7, true);
-    registry.emplace<ColorComponent>(counter7, DARKBROWN);
+// spawn timer for customers
+entt::entity create_spawn_timer(CafeWorld& world)
+{
+    entt::registry& registry = world.registry;
 
-    // customer-side obstacles
-    entt::entity chair1 = registry.create();
-    registry.emplace<SquareComponent>(chair1, GRID_SIZE / 4.0f);
-    registry.emplace<PositionComponent>(chair1, Vector2{7.5f * GRID_SIZE, 2.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(chair1, 1.0f, 0.0f);
-    registry.emplace<ChairComponent>(chair1, entt::null);
-    registry.emplace<ColorComponent>(chair1, BEIGE);
+    world.spawn_timer = registry.create();
+    registry.emplace<TimerComponent>(world.spawn_timer, head_start_time); // time before first customer
+
+    return world.spawn_timer;
+}
+
+// A counter. Free counters can have things put on them,
+// the others hold a station (stack, machine, pitcher) placed on them afterwards
+entt::entity create_counter(CafeWorld& world, Vector2 position, bool free)
+{
+    entt::registry& registry = world.registry;
+
+    entt::entity counter = registry.create();
+    registry.emplace<SquareComponent>(counter, GRID_SIZE / 2.0f);
+    registry.emplace<PositionComponent>(counter, position);
+    registry.emplace<PhysicsComponent>(counter, 1.0f, 0.0f);
+    registry.emplace<InteractableComponent>(counter, free, false);
+    registry.emplace<TableComponent>(counter, true);
+    registry.emplace<InteractionComponent>(counter, uint16_t(KIND_TABLE));
+    registry.emplace<ColorComponent>(counter, DARKBROWN);
+
+    return counter;
+}
+
+// A dining table with its chair one tile above it
+entt::entity create_dining_table(CafeWorld& world, Vector2 position)
+{
+    entt::registry& registry = world.registry;
+
+    entt::entity chair = registry.create();
+    registry.emplace<SquareComponent>(chair, GRID_SIZE / 4.0f);
+    registry.emplace<PositionComponent>(chair, Vector2{position.x, position.y - GRID_SIZE});
+    registry.emplace<PhysicsComponent>(chair, 1.0f, 0.0f);
+    registry.emplace<ChairComponent>(chair, entt::null);
+    registry.emplace<ColorComponent>(chair, BEIGE);
 
     entt::entity dining_table = registry.create();
     registry.emplace<SquareComponent>(dining_table, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(dining_table, Vector2{7.5f * GRID_SIZE, 3.5f * GRID_SIZE});
+    registry.emplace<PositionComponent>(dining_table, position);
     registry.emplace<PhysicsComponent>(dining_table, 1.0f, 0.0f);
     registry.emplace<InteractableComponent>(dining_table, true, false);
     registry.emplace<TableComponent>(dining_table, false);
-    registry.emplace<DiningTableComponent>(dining_table, chair1);
+    registry.emplace<DiningTableComponent>(dining_table, chair);
+    registry.emplace<InteractionComponent>(dining_table, uint16_t(KIND_TABLE));
     registry.emplace<ColorComponent>(dining_table, BROWN);
 
-    entt::entity chair2 = registry.create();
-    registry.emplace<SquareComponent>(chair2, GRID_SIZE / 4.0f);
-    registry.emplace<PositionComponent>(chair2, Vector2{5.5f * GRID_SIZE, 2.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(chair2, 1.0f, 0.0f);
-    registry.emplace<ChairComponent>(chair2, entt::null);
-    registry.emplace<ColorComponent>(chair2, BEIGE);
-
-    entt::entity dining_table2 = registry.create();
-    registry.emplace<SquareComponent>(dining_table2, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(dining_table2, Vector2{5.5f * GRID_SIZE, 3.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(dining_table2, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(dining_table2, true, false);
-    registry.emplace<TableComponent>(dining_table2, false);
-    registry.emplace<DiningTableComponent>(dining_table2, chair2);
-    registry.emplace<ColorComponent>(dining_table2, BROWN);
-
-    entt::entity chair3 = registry.create();
-    registry.emplace<SquareComponent>(chair3, GRID_SIZE / 4.0f);
-    registry.emplace<PositionComponent>(chair3, Vector2{3.5f * GRID_SIZE, 2.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(chair3, 1.0f, 0.0f);
-    registry.emplace<ChairComponent>(chair3, entt::null);
-    registry.emplace<ColorComponent>(chair3, BEIGE);
-
-    entt::entity dining_table3 = registry.create();
-    registry.emplace<SquareComponent>(dining_table3, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(dining_table3, Vector2{3.5f * GRID_SIZE, 3.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(dining_table3, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(dining_table3, true, false);
-    registry.emplace<TableComponent>(dining_table3, false);
-    registry.emplace<DiningTableComponent>(dining_table3, chair3);
-    registry.emplace<ColorComponent>(dining_table3, BROWN);
-
-    entt::entity chair4 = registry.create();
-    registry.emplace<SquareComponent>(chair4, GRID_SIZE / 4.0f);
-    registry.emplace<PositionComponent>(chair4, Vector2{9.5f * GRID_SIZE, 2.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(chair4, 1.0f, 0.0f);
-    registry.emplace<ChairComponent>(chair4, entt::null);
-    registry.emplace<ColorComponent>(chair4, BEIGE);
-
-    entt::entity dining_table4 = registry.create();
-    registry.emplace<SquareComponent>(dining_table4, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(dining_table4, Vector2{9.5f * GRID_SIZE, 3.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(dining_table4, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(dining_table4, true, false);
-    registry.emplace<TableComponent>(dining_table4, false);
-    registry.emplace<DiningTableComponent>(dining_table4, chair4);
-    registry.emplace<ColorComponent>(dining_table4, BROWN);
-
-    entt::entity chair5 = registry.create();
-    registry.emplace<SquareComponent>(chair5, GRID_SIZE / 4.0f);
-    registry.emplace<PositionComponent>(chair5, Vector2{11.5f * GRID_SIZE, 2.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(chair5, 1.0f, 0.0f);
-    registry.emplace<ChairComponent>(chair5, entt::null);
-    registry.emplace<ColorComponent>(chair5, BEIGE);
-
-    entt::entity dining_table5 = registry.create();
-    registry.emplace<SquareComponent>(dining_table5, GRID_SIZE / 2.0f);
-    registry.emplace<PositionComponent>(dining_table5, Vector2{11.5f * GRID_SIZE, 3.5f * GRID_SIZE});
-    registry.emplace<PhysicsComponent>(dining_table5, 1.0f, 0.0f);
-    registry.emplace<InteractableComponent>(dining_table5, true, false);
-    registry.emplace<TableComponent>(dining_table5, false);
-    registry.emplace<DiningTableComponent>(dining_table5, chair5);
-    registry.emplace<ColorComponent>(dining_table5, BROWN);
+    return dining_table;
+}
+
+entt::entity create_cup_stack(CafeWorld& world, Vector2 position)
+{
+    entt::registry& registry = world.registry;
 
-    // item
     entt::entity stack_of_cups = registry.create();
-    registry.emplace<PositionComponent>(stack_of_cups, Vector2{4.5f * GRID_SIZE, 6.5f * GRID_SIZE});
+    registry.emplace<PositionComponent>(stack_of_cups, position);
     registry.emplace<InteractableComponent>(stack_of_cups, true, false);
     registry.emplace<StackComponent>(stack_of_cups, "cup");
+    registry.emplace<InteractionComponent>(stack_of_cups, uint16_t(KIND_STACK));
     registry.emplace<ColorComponent>(stack_of_cups, ORANGE);
 
+    return stack_of_cups;
+}
+
+entt::entity create_coffee_machine(CafeWorld& world, Vector2 position)
+{
+    entt::registry& registry = world.registry;
+
     entt::entity coffee_machine = registry.create();
-    registry.emplace<PositionComponent>(coffee_machine, Vector2{5.5f * GRID_SIZE, 6.5f * GRID_SIZE});
+    registry.emplace<PositionComponent>(coffee_machine, position);
     registry.emplace<InteractableComponent>(coffee_machine, true, false);
     registry.emplace<TableComponent>(coffee_machine, false);
     registry.emplace<CoffeeMachineComponent>(coffee_machine, false, false, entt::null);
+    registry.emplace<InteractionComponent>(coffee_machine, uint16_t(KIND_MACHINE | KIND_TABLE));
     registry.emplace<TimerComponent>(coffee_machine, 0.0f);
     registry.emplace<ColorComponent>(coffee_machine, BLACK);
 
-    entt::entity coffee_bean_container = registry.create();
-    registry.emplace<PositionComponent>(coffee_bean_container, Vector2{6.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<InteractableComponent>(coffee_bean_container, true, false);
-    registry.emplace<StackComponent>(coffee_bean_container, "ingredient");
-    registry.emplace<IngredientComponent>(coffee_bean_container, "coffee bean", false);
-    registry.emplace<ColorComponent>(coffee_bean_container, PINK);
-
-    entt::entity water_pitcher = registry.create();
-    registry.emplace<PositionComponent>(water_pitcher, Vector2{7.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<InteractableComponent>(water_pitcher, true, false);
-    registry.emplace<HoldableComponent>(water_pitcher, false);
-    registry.emplace<PlaceableComponent>(water_pitcher, counter4);
-    registry.emplace<IngredientComponent>(water_pitcher, "water", true);
-    registry.emplace<ColorComponent>(water_pitcher, SKYBLUE);
-
-    entt::entity kettle = registry.create();
-    registry.emplace<PositionComponent>(kettle, Vector2{10.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<InteractableComponent>(kettle, true, false);
-    registry.emplace<HoldableComponent>(kettle, false);
-    registry.emplace<PlaceableComponent>(kettle, counter6);
-    registry.emplace<IngredientComponent>(kettle, "hot water", true);
-    registry.emplace<ColorComponent>(kettle, RED);
-
-
-    entt::entity milk_jug = registry.create();
-    registry.emplace<PositionComponent>(milk_jug, Vector2{11.5f * GRID_SIZE, 6.5f * GRID_SIZE});
-    registry.emplace<InteractableComponent>(milk_jug, true, false);
-    registry.emplace<HoldableComponent>(milk_jug, false);
-    registry.emplace<PlaceableComponent>(milk_jug, counter7);
-    registry.emplace<IngredientComponent>(milk_jug, "milk", true);
-    registry.emplace<ColorComponent>(milk_jug, WHITE);
+    return coffee_machine;
 }
 
-void reserve_memory()
+entt::entity create_ingredient_stack(CafeWorld& world, Vector2 position, const std::string& ingredient, Color color)
 {
-    queue.reserve(total_customers_today[5]);
-    available_tables.reserve(5);
+    entt::registry& registry = world.registry;
+
+    entt::entity container = registry.create();
+    registry.emplace<PositionComponent>(container, position);
+    registry.emplace<InteractableComponent>(container, true, false);
+    registry.emplace<StackComponent>(container, "ingredient");
+    registry.emplace<IngredientComponent>(container, ingredient, false);
+    registry.emplace<InteractionComponent>(container, uint16_t(KIND_STACK | KIND_INGREDIENT));
+    registry.emplace<ColorComponent>(container, color);
+
+    return container;
 }
 
-void read_player_input(entt::registry& registry, entt::entity& player)
+// A pitcher standing on the counter
+entt::entity create_pitcher(CafeWorld& world, entt::entity counter, const std::string& ingredient, Color color)
 {
-    //MOVEMENT
-    Vector2 forces = Vector2Zero(); // every frame set the forces to a 0 vector
+    entt::registry& registry = world.registry;
+
+    entt::entity pitcher = registry.create();
+    registry.emplace<PositionComponent>(pitcher, registry.get<PositionComponent>(counter).position);
+    registry.emplace<InteractableComponent>(pitcher, true, false);
+    registry.emplace<HoldableComponent>(pitcher, false);
+    registry.emplace<PlaceableComponent>(pitcher, counter);
+    registry.emplace<IngredientComponent>(pitcher, ingredient, true);
+    registry.emplace<InteractionComponent>(pitcher, uint16_t(KIND_HOLDABLE | KIND_INGREDIENT | KIND_PITCHER));
+    registry.emplace<ColorComponent>(pitcher, color);
+
+    return pitcher;
+}
 
-    // Adds forces with the magnitude of 200 in the direction given by WASD inputs
-    if(IsKeyDown(KEY_W)) {
-        forces = Vector2Add(forces, {0, -200});
-    }
-    if(IsKeyDown(KEY_A)) {
-        forces = Vector2Add(forces, {-200, 0});
-    }
-    if(IsKeyDown(KEY_S)) {
-        forces = Vector2Add(forces, {0, 200});
+void init_entities(CafeWorld& world)
+{
+    create_player(world, Vector2{8.5f * GRID_SIZE, 7.5f * GRID_SIZE});
+    create_spawn_timer(world);
+
+    // counters
+    create_counter(world, Vector2{4.5f * GRID_SIZE, 6.5f * GRID_SIZE}, false);
+    create_counter(world, Vector2{5.5f * GRID_SIZE, 6.5f * GRID_SIZE}, false);
+    create_counter(world, Vector2{6.5f * GRID_SIZE, 6.5f * GRID_SIZE}, false);
+    entt::entity counter4 = create_counter(world, Vector2{7.5f * GRID_SIZE, 6.5f * GRID_SIZE}, false);
+    create_counter(world, Vector2{9.5f * GRID_SIZE, 6.5f * GRID_SIZE}, true);
+    entt::entity counter6 = create_counter(world, Vector2{10.5f * GRID_SIZE, 6.5f * GRID_SIZE}, false);
+    entt::entity counter7 = create_counter(world, Vector2{11.5f * GRID_SIZE, 6.5f * GRID_SIZE}, false);
+
+    // customer-side obstacles
+    create_dining_table(world, Vector2{7.5f * GRID_SIZE, 3.5f * GRID_SIZE});
+    create_dining_table(world, Vector2{5.5f * GRID_SIZE, 3.5f * GRID_SIZE});
+    create_dining_table(world, Vector2{3.5f * GRID_SIZE, 3.5f * GRID_SIZE});
+    create_dining_table(world, Vector2{9.5f * GRID_SIZE, 3.5f * GRID_SIZE});
+    create_dining_table(world, Vector2{11.5f * GRID_SIZE, 3.5f * GRID_SIZE});
+
+    // item
+    create_cup_stack(world, Vector2{4.5f * GRID_SIZE, 6.5f * GRID_SIZE});
+    create_coffee_machine(world, Vector2{5.5f * GRID_SIZE, 6.5f * GRID_SIZE});
+    create_ingredient_stack(world, Vector2{6.5f * GRID_SIZE, 6.5f * GRID_SIZE}, "coffee bean", PINK);
+
+    create_pitcher(world, counter4, "water", SKYBLUE);
+    create_pitcher(world, counter6, "hot water", RED);
+    create_pitcher(world, counter7, "milk", WHITE);
+
+    world.navigation_dirty = true;
+}
+
+// Rebuilds the walkable tiles and the collision tilemap from the static obstacles if the
+// layout may have changed. Cached flow fields survive unless the tiles actually differ
+void refresh_navigation(CafeWorld& world)
+{
+    if (!world.navigation_dirty) return;
+
+    entt::registry& registry = world.registry;
+    Navigation& navigation = world.navigation;
+
+    std::vector<uint8_t> layout(navigation.GetColumns() * navigation.GetRows(), 1);
+
+    world.tilemap.Resize(navigation.GetColumns(), navigation.GetRows(), GRID_SIZE);
+    world.loose_obstacles.clear();
+
+    auto obstacles = registry.view<SquareComponent, PhysicsComponent, PositionComponent>();
+    for (auto entity : obstacles)
+    {
+        if (registry.try_get<MoveComponent>(entity)) continue;
+
+        Vector2 position = registry.get<PositionComponent>(entity).position;
+        layout[navigation.TileAt(position)] = 0;
+
+        if (!world.tilemap.Add(position, registry.get<SquareComponent>(entity).half_size))
+            world.loose_obstacles.push_back(entity);
     }
-    if(IsKeyDown(KEY_D)) {
-        forces = Vector2Add(forces, {200, 0});
+
+    navigation.SetLayout(layout);
+    world.navigation_dirty = false;
+}
+
+// Fires a sound effect. Dropped if there is no audio or its queue is full
+void play_sound(CafeWorld& world, SoundEffect effect)
+{
+    if (world.sounds)
+        world.sounds->Push(effect);
+}
+
+// Puts a sleeping body back into physics. Anything that moves a body from outside
+// physics (input, walking, a push) wakes it, or it would stay where it fell asleep
+void wake_body(CafeWorld& world, entt::entity entity)
+{
+    entt::registry& registry = world.registry;
+
+    registry.remove<SleepingComponent>(entity);
+
+    StillnessComponent* stillness = registry.try_get<StillnessComponent>(entity);
+    if (stillness) stillness->ticks = 0;
+}
+
+// Sets a customer's velocity to walk towards the point along the flow field of its tile.
+// Returns true once the customer is standing on the point
+bool walk_customer(CafeWorld& world, entt::entity entity, Vector2 point)
+{
+    entt::registry& registry = world.registry;
+
+    PositionComponent& pos = registry.get<PositionComponent>(entity);
+    MoveComponent& m = registry.get<MoveComponent>(entity);
+
+    // close enough to arrive this tick
+    if (Vector2Distance(pos.position, point) <= customer_speed * TIMESTEP)
+    {
+        pos.position = point;
+        m.velocity = Vector2Zero();
+        return true;
     }
 
-    AccelerationComponent& a = registry.get<AccelerationComponent>(player);
-    PhysicsComponent& p1_phy = registry.get<PhysicsComponent>(player);
-    // Does Vector - Scalar multiplication with the sum of all forces and the inverse mass of the ball
-    a.acceleration = Vector2Scale(forces, p1_phy.inverse_mass);
+    int destination = world.navigation.TileAt(point);
+    Vector2 direction;
 
-    if (Vector2Length(forces) > 0)
+    // the point can be off the grid (the entrance), so the last stretch is walked straight
+    if (world.navigation.TileAt(pos.position) == destination)
+        direction = Vector2Normalize(Vector2Subtract(point, pos.position));
+    else
+        direction = world.navigation.Steer(pos.position, destination);
+
+    m.velocity = Vector2Scale(direction, customer_speed);
+    wake_body(world, entity);
+
+    DirectionComponent& dir = registry.get<DirectionComponent>(entity);
+    dir.forward = direction;
+
+    return false;
+}
+
+// Takes back all of the last day's memory at once. Only call it once everything made
+// during the day is gone (the level was restored or rebuilt)
+void reset_day_memory(CafeWorld& world)
+{
+    // their buffers are in the arena, so they let go of them first
+    std::pmr::vector<entt::entity>(world.queue.get_allocator()).swap(world.queue);
+    std::pmr::vector<entt::entity>(world.available_tables.get_allocator()).swap(world.available_tables);
+
+    world.day_arena.Reset();
+}
+
+void reserve_memory(CafeWorld& world)
+{
+    world.queue.reserve(size_t(fmaxf(world.total_customers_today[5], world.total_customers_today[world.day])));
+    world.available_tables.reserve(world.registry.storage<DiningTableComponent>().size());
+}
+
+// What the player does this tick.
+// Filled from the keyboard (input_events.hpp), or by the autopilot (autopilot.hpp) when nobody is playing
+struct PlayerInput
+{
+    Vector2 forces;     // movement force, 200 per direction
+    bool interact;      // interact key pressed this tick
+};
+
+// INTERACTIONS
+// What the interact key does is looked up from the kinds of the held item and the hot
+// item (InteractionComponent) in interaction_table. Every handler gets a hot item and,
+// except for the empty-handed ones, a held item of the kinds it was picked for
+
+typedef void (*InteractionHandler)(CafeWorld& world, InteractorComponent& interactor, HolderComponent& holder);
+
+// the hot item's money is added to the score
+void collect_payment(CafeWorld& world, InteractorComponent& interactor, HolderComponent&)
+{
+    entt::registry& registry = world.registry;
+
+    MoneyComponent& payment = registry.get<MoneyComponent>(interactor.hot_item);
+
+    // add payment to score
+    world.score += payment.amount;
+    world.day_score += payment.amount;
+
+    // update table's status
+    PlaceableComponent& placeable = registry.get<PlaceableComponent>(interactor.hot_item);
+    TableComponent& table = registry.get<TableComponent>(placeable.table);
+    table.hasItemOnTop = false;
+
+    InteractableComponent& i = registry.get<InteractableComponent>(placeable.table);
+    i.isEnabled = true;
+
+    // update placeable's "table" to null
+    placeable.table = entt::null;
+
+    // destroy money object
+    registry.destroy(interactor.hot_item);
+
+    play_sound(world, SFX_PAYMENT);
+
+    // set hot item to null
+    interactor.hot_item = entt::null;
+}
+
+// empty hands, the hot item is picked up off its table
+void pick_up(CafeWorld& world, InteractorComponent& interactor, HolderComponent& holder)
+{
+    entt::registry& registry = world.registry;
+
+    // set held item to hot item
+    holder.held_item = interactor.hot_item;
+    registry.get<HoldableComponent>(interactor.hot_item).isHeld = true;
+
+    // make held item not interactable and not hot
+    InteractableComponent& item = registry.get<InteractableComponent>(interactor.hot_item);
+    item.isEnabled = false;
+    item.isHot = false;
+
+    // update table's status
+    PlaceableComponent& placeable = registry.get<PlaceableComponent>(interactor.hot_item);
+    TableComponent& table = registry.get<TableComponent>(placeable.table);
+    table.hasItemOnTop = false;
+
+    InteractableComponent& i = registry.get<InteractableComponent>(placeable.table);
+    i.isEnabled = true;
+
+    // update placeable's "table" to null
+    placeable.table = entt::null;
+
+    // set hot item to null
+    interactor.hot_item = entt::null;
+
+    uint16_t kinds = registry.get<InteractionComponent>(holder.held_item).kinds;
+    if (kinds & KIND_DRINK)
+        cafe_log(world) << "Got " << registry.get<DrinkComponent>(holder.held_item).name << "\n";
+    else if (kinds & KIND_INGREDIENT)
+        cafe_log(world) << "Got " << registry.get<IngredientComponent>(holder.held_item).name << "\n";
+}
+
+// empty hands, a new cup or ingredient comes off the stack
+void take_from_stack(CafeWorld& world, InteractorComponent& interactor, HolderComponent& holder)
+{
+    entt::registry& registry = world.registry;
+
+    StackComponent& stack = registry.get<StackComponent>(interactor.hot_item);
+
+    // create a new entity (an object from the stack)
+    entt::entity new_entity = registry.create();
+
+    registry.emplace<PositionComponent>(new_entity, Vector2Zero());     // position doesnt matter if held
+    registry.emplace<InteractableComponent>(new_entity, false, false);  // not enabled, not hot
+    registry.emplace<HoldableComponent>(new_entity, true);              // is held
+    registry.emplace<PlaceableComponent>(new_entity, entt::null);       // not placed on anything
+
+    if (stack.type == "cup")
     {
-        DirectionComponent& dir = registry.get<DirectionComponent>(player);
-        dir.forward = Vector2Normalize(forces);
+        registry.emplace<DrinkComponent>(new_entity, "empty");
+        registry.emplace<InteractionComponent>(new_entity, uint16_t(KIND_HOLDABLE | KIND_DRINK));
+
+        registry.emplace<SpriteComponent>(new_entity, hot_coffee,
+                                            std::pmr::vector<Rectangle>({
+                                                {112,0,16,16}
+                                            }, world.day_arena.Resource()), 0);
+
+        registry.emplace<ColorComponent>(new_entity, MAROON);
+
+        cafe_log(world) << "Got empty cup\n"; 
     }
+    else if (stack.type == "ingredient")
+    {
+        IngredientComponent& ingredient = registry.get<IngredientComponent>(interactor.hot_item);
+        registry.emplace<IngredientComponent>(new_entity, ingredient.name, false);
+        registry.emplace<InteractionComponent>(new_entity, uint16_t(KIND_HOLDABLE | KIND_INGREDIENT));
 
-    //INTERACT
-    InteractorComponent& interactor = registry.get<InteractorComponent>(player);
+        registry.emplace<SpriteComponent>(new_entity, bean,
+                                            std::pmr::vector<Rectangle>({
+                                                {0,0,16,16}
+                                            }, world.day_arena.Resource()), 0);
 
-    if(IsKeyPressed(KEY_X) && interactor.hot_item != entt::null)
+        if (ingredient.name == "coffee bean")
+            registry.emplace<ColorComponent>(new_entity, YELLOW);
+        
+        cafe_log(world) << "Got " << ingredient.name << "\n";
+    }
+
+    // set held item to new entity
+    holder.held_item = new_entity;
+
+    // set hot item to null
+    interactor.hot_item = entt::null;
+}
+
+// the held item goes into the coffee machine, which starts once it has everything
+void use_coffee_machine(CafeWorld& world, InteractorComponent& interactor, HolderComponent& holder)
+{
+    entt::registry& registry = world.registry;
+
+    CoffeeMachineComponent& machine = registry.get<CoffeeMachineComponent>(interactor.hot_item);
+    uint16_t held = registry.get<InteractionComponent>(holder.held_item).kinds;
+
+    // if holding an ingredient
+    if (held & KIND_INGREDIENT)
     {
-        MoneyComponent* payment = registry.try_get<MoneyComponent>(interactor.hot_item);
-        if (payment)
+        IngredientComponent& ingredient = registry.get<IngredientComponent>(holder.held_item);
+
+        // if holding coffee bean / grounds and machine has no coffee yet
+        if (ingredient.name == "coffee bean" && !machine.hasCoffeeGrounds)
         {
-            // add payment to score
-            score += payment->amount;
-            day_score += payment->amount;
+            // fill machine with coffee
+            machine.hasCoffeeGrounds = true;
 
-            // update table's status
-            PlaceableComponent& placeable = registry.get<PlaceableComponent>(interactor.hot_item);
-            TableComponent& table = registry.get<TableComponent>(placeable.table);
-            table.hasItemOnTop = false;
+            // destroy entity
+            registry.destroy(holder.held_item);
 
-            InteractableComponent& i = registry.get<InteractableComponent>(placeable.table);
-            i.isEnabled = true;
+            // remove it from the hands of holder
+            holder.held_item = entt::null;
 
-            // update placeable's "table" to null
-            placeable.table = entt::null;
-
-            // destroy money object
-            registry.destroy(interactor.hot_item);
-            
-            // set hot item to null
-            interactor.hot_item = entt::null;
-            
-            return;
+            cafe_log(world) << "Filled machine with coffee grounds\n";
         }
 
-        HolderComponent& holder = registry.get<HolderComponent>(player);
-
-        // if there is no held item
-        if (holder.held_item == entt::null)
+        // else if holding water pitcher and machine has no water yet
+        else if (ingredient.name == "water" && !machine.hasWater)
         {
-            HoldableComponent* holdable = registry.try_get<HoldableComponent>(interactor.hot_item);
+            // fill machine with water
+            machine.hasWater = true;
 
-            // if hot item is holdable
-            if (holdable)
-            {
-                // set held item to hot item
-                holder.held_item = interactor.hot_item;
-                holdable->isHeld = true;
+            cafe_log(world) << "Filled machine with water\n";
+        }
+    }
+    else if (held & KIND_DRINK)
+    {
+        DrinkComponent& drink = registry.get<DrinkComponent>(holder.held_item);
 
-                // make held item not interactable and not hot
-                InteractableComponent& item = registry.get<InteractableComponent>(interactor.hot_item);
-                item.isEnabled = false;
-                item.isHot = false;
+        // if held item is an empty cup, and the machine has no cup yet
+        if (drink.name == "empty" && machine.drink == entt::null)
+        {
+            // set cup on coffee machine
+            PositionComponent& machine_pos = registry.get<PositionComponent>(interactor.hot_item);
+            PositionComponent& cup_pos = registry.get<PositionComponent>(holder.held_item);
+            cup_pos.position = Vector2Add(machine_pos.position, {0.0f, GRID_SIZE * 0.15f});
 
-                // update table's status
-                PlaceableComponent& placeable = registry.get<PlaceableComponent>(interactor.hot_item);
-                TableComponent& table = registry.get<TableComponent>(placeable.table);
-                table.hasItemOnTop = false;
+            PlaceableComponent& placeable = registry.get<PlaceableComponent>(holder.held_item);
+            placeable.table = interactor.hot_item;
 
-                InteractableComponent& i = registry.get<InteractableComponent>(placeable.table);
-                i.isEnabled = true;
+            machine.drink = holder.held_item;
 
-                // update placeable's "table" to null
-                placeable.table = entt::null;
+            // keep cup not interactable, coffee machine interactable
 
-                // set hot item to null
-                interactor.hot_item = entt::null;
+            // remove cup from hands of holder
+            HoldableComponent& holdable = registry.get<HoldableComponent>(holder.held_item);
+            holdable.isHeld = false;
 
-                DrinkComponent* drink = registry.try_get<DrinkComponent>(holder.held_item);
-                if (drink)
-                    std::cout << "Got " << drink->name << "\n";
-                else
-                {
-                    IngredientComponent* ingredient = registry.try_get<IngredientComponent>(holder.held_item);
-                    if (ingredient)
-                        std::cout << "Got " << ingredient->name << "\n";
-                }
-                
-                return;
-            }
+            holder.held_item = entt::null;
 
-            StackComponent* stack = registry.try_get<StackComponent>(interactor.hot_item);
+            cafe_log(world) << "Placed cup in machine\n";
+        }
+    }
 
-            // else if hot item is stack
-            if (stack)
-            {
-                // create a new entity (an object from the stack)
-                entt::entity new_entity = registry.create();
+    TimerComponent& timer = registry.get<TimerComponent>(interactor.hot_item);
 
-                registry.emplace<PositionComponent>(new_entity, Vector2Zero());     // position doesnt matter if held
-                registry.emplace<InteractableComponent>(new_entity, false, false);  // not enabled, not hot
-                registry.emplace<HoldableComponent>(new_entity, true);              // is held
-                registry.emplace<PlaceableComponent>(new_entity, entt::null);       // not placed on anything
+    // if timer has not been set, and coffee machine is all set up
+    if (FloatEquals(timer.time, 0.0f) &&
+        machine.hasCoffeeGrounds && machine.hasWater && machine.drink != entt::null)
+    {
+        // disable interactions with machine
+        InteractableComponent& i = registry.get<InteractableComponent>(interactor.hot_item);
+        i.isEnabled = false;
+        i.isHot = false;
 
-                if (stack->type == "cup")
-                {
-                    registry.emplace<DrinkComponent>(new_entity, "empty");
+        // remove coffee grounds and water
+        machine.hasCoffeeGrounds = false;
+        machine.hasWater = false;
 
-                    registry.emplace<SpriteComponent>(new_entity, hot_coffee,
-                                                        std::vector<Rectangle>{
-                                                            {112,0,16,16}
-                                                        }, 0);
+        // set timer
+        timer.time = world.brew_time;
 
-                    registry.emplace<ColorComponent>(new_entity, MAROON);
+        cafe_log(world) << "Activated coffee machine for " << timer.time << " seconds\n";
+    }
 
-                    std::cout << "Got empty cup\n"; 
-                }
-                else if (stack->type == "ingredient")
-                {
-                    IngredientComponent& ingredient = registry.get<IngredientComponent>(interactor.hot_item);
-                    registry.emplace<IngredientComponent>(new_entity, ingredient.name);
-
-                    registry.emplace<SpriteComponent>(new_entity, bean,
-                                                        std::vector<Rectangle>{
-                                                            {0,0,16,16}
-                                                        }, 0);
-
-                    if (ingredient.name == "coffee bean")
-                        registry.emplace<ColorComponent>(new_entity, YELLOW);
-                    
-                    std::cout << "Got " << ingredient.name << "\n";
-                }
+    // set hot item to null
+    interactor.hot_item = entt::null;
+}
 
-                // set held item to new entity
-                holder.held_item = new_entity;
+// the held drink goes to the customer if it is what they ordered
+void serve_customer(CafeWorld& world, InteractorComponent& interactor, HolderComponent& holder)
+{
+    entt::registry& registry = world.registry;
 
-                // set hot item to null
-                interactor.hot_item = entt::null;
-                
-                return;
-            }
-        }
+    CustomerComponent& customer = registry.get<CustomerComponent>(interactor.hot_item);
+    DrinkComponent& drink = registry.get<DrinkComponent>(holder.held_item);
 
-        // else if there is a held item
-        else
-        {
-            HolderComponent& holder = registry.get<HolderComponent>(player);
-            CoffeeMachineComponent* machine = registry.try_get<CoffeeMachineComponent>(interactor.hot_item);
+    // if the drink is the customer's order (and they are still waiting for it)
+    if (drink.name != customer.order || customer.state != "Ordering")
+        return;
 
-            // if hot item is a coffee machine
-            if (machine)
-            {
-                IngredientComponent* ingredient = registry.try_get<IngredientComponent>(holder.held_item);
+    // make customer not interactable
+    InteractableComponent& i = registry.get<InteractableComponent>(interactor.hot_item);
+    i.isEnabled = false;
+    i.isHot = false;
 
-                // if holding an ingredient
-                if (ingredient)
-                {
-                    // if holding coffee bean / grounds and machine has no coffee yet
-                    if (ingredient->name == "coffee bean" && !machine->hasCoffeeGrounds)
-                    {
-                        // fill machine with coffee
-                        machine->hasCoffeeGrounds = true;
+    // put drink on customer
+    PositionComponent& drink_pos = registry.get<PositionComponent>(holder.held_item);
+    PositionComponent& customer_pos = registry.get<PositionComponent>(interactor.hot_item);
+    drink_pos.position = Vector2Add(customer_pos.position, {radius / 1.5f, radius / 1.5f});
 
-                        // destroy entity
-                        registry.destroy(holder.held_item);
+    customer.drink = holder.held_item;
 
-                        // remove it from the hands of holder
-                        holder.held_item = entt::null;
+    // let customer eat
+    customer.state = "Eating";
 
-                        std::cout << "Filled machine with coffee grounds\n";
-                    }
+    TimerComponent& timer = registry.get<TimerComponent>(interactor.hot_item);
+    timer.time = world.consume_time;
 
-                    // else if holding water pitcher and machine has no water yet
-                    else if (ingredient->name == "water" && !machine->hasWater)
-                    {
-                        // fill machine with water
-                        machine->hasWater = true;
+    // remove item from hands of holder
+    HoldableComponent& holdable = registry.get<HoldableComponent>(holder.held_item);
+    holdable.isHeld = false;
 
-                        std::cout << "Filled machine with water\n";
-                    }
-                }
-                else
-                {
-                    DrinkComponent* drink = registry.try_get<DrinkComponent>(holder.held_item);
+    holder.held_item = entt::null;
 
-                    // if held item is an empty cup, and the machine has no cup yet
-                    if (drink && drink->name == "empty" && machine->drink == entt::null)
-                    {
-                        // set cup on coffee machine
-                        PositionComponent& machine_pos = registry.get<PositionComponent>(interactor.hot_item);
-                        PositionComponent& cup_pos = registry.get<PositionComponent>(holder.held_item);
-                        cup_pos.position = Vector2Add(machine_pos.position, {0.0f, GRID_SIZE * 0.15f});
+    // set hot item to null
+    interactor.hot_item = entt::null;
 
-                        PlaceableComponent& placeable = registry.get<PlaceableComponent>(holder.held_item);
-                        placeable.table = interactor.hot_item;
+    cafe_log(world) << "Served customer with " << customer.order << "\n";
+}
 
-                        machine->drink = holder.held_item;
+// the held item is put down on the table
+void put_on_table(CafeWorld& world, InteractorComponent& interactor, HolderComponent& holder)
+{
+    entt::registry& registry = world.registry;
 
-                        // keep cup not interactable, coffee machine interactable
+    TableComponent& table = registry.get<TableComponent>(interactor.hot_item);
+    table.hasItemOnTop = true;
 
-                        // remove cup from hands of holder
-                        HoldableComponent& holdable = registry.get<HoldableComponent>(holder.held_item);
-                        holdable.isHeld = false;
+    // make table not interactable
+    InteractableComponent& i = registry.get<InteractableComponent>(interactor.hot_item);
+    i.isEnabled = false;
+    i.isHot = false;
 
-                        holder.held_item = entt::null;
+    // set held item on top of table
+    PositionComponent& table_pos = registry.get<PositionComponent>(interactor.hot_item);
+    PositionComponent& item_pos = registry.get<PositionComponent>(holder.held_item);
+    item_pos.position = table_pos.position;
 
-                        std::cout << "Placed cup in machine\n";
-                    }
-                }
+    PlaceableComponent& placeable = registry.get<PlaceableComponent>(holder.held_item);
+    placeable.table = interactor.hot_item;
 
-                TimerComponent& timer = registry.get<TimerComponent>(interactor.hot_item);
+    // make item interactable
+    InteractableComponent& item = registry.get<InteractableComponent>(holder.held_item);
+    item.isEnabled = true;
 
-                // if timer has not been set, and coffee machine is all set up
-                if (FloatEquals(timer.time, 0.0f) &&
-                    machine->hasCoffeeGrounds && machine->hasWater && machine->drink != entt::null)
-                {
-                    // disable interactions with machine
-                    InteractableComponent& i = registry.get<InteractableComponent>(interactor.hot_item);
-                    i.isEnabled = false;
-                    i.isHot = false;
+    HoldableComponent& holdable = registry.get<HoldableComponent>(holder.held_item);
+    holdable.isHeld = false;
 
-                    // remove coffee grounds and water
-                    machine->hasCoffeeGrounds = false;
-                    machine->hasWater = false;
+    // remove item from hands of holder
+    holder.held_item = entt::null;
 
-                    // set timer
-                    timer.time = brew_time;
+    // set hot item to null
+    interactor.hot_item = entt::null;
+}
 
-                    std::cout << "Activated coffee machine for " << timer.time << " seconds\n";
-                }
+// the held pitcher is poured into the drink, if the two make something
+void combine_into_drink(CafeWorld& world, InteractorComponent& interactor, HolderComponent& holder)
+{
+    entt::registry& registry = world.registry;
 
-                // set hot item to null
-                interactor.hot_item = entt::null;
+    DrinkComponent& drink = registry.get<DrinkComponent>(interactor.hot_item);
+    IngredientComponent& ingredient = registry.get<IngredientComponent>(holder.held_item);
 
-                return;
-            }
+    // if the combination of the drink and ingredient is valid / is in the map data structure
+    auto result = combine.find(std::make_pair(drink.name, ingredient.name));
+    if (result == combine.end())
+        return;
 
-            CustomerComponent* customer = registry.try_get<CustomerComponent>(interactor.hot_item);
+    cafe_log(world) << "Combined " << drink.name << " and " << ingredient.name;
 
-            // else if the hot item is a customer
-            if (customer)
-            {
-                DrinkComponent* drink = registry.try_get<DrinkComponent>(holder.held_item);
+    // combine ingredient with drink
+    drink.name = result->second;
 
-                // if holding drink and drink is the customer's order
-                if (drink && drink->name == customer->order)
-                {
-                    // make customer not interactable
-                    InteractableComponent& i = registry.get<InteractableComponent>(interactor.hot_item);
-                    i.isEnabled = false;
-                    i.isHot = false;
+    cafe_log(world) << " into " << drink.name << "\n";
 
-                    // put drink on customer
-                    PositionComponent& drink_pos = registry.get<PositionComponent>(holder.held_item);
-                    PositionComponent& customer_pos = registry.get<PositionComponent>(interactor.hot_item);
-                    drink_pos.position = Vector2Add(customer_pos.position, {radius / 1.5f, radius / 1.5f});
+    // set hot item to null
+    interactor.hot_item = entt::null;
+}
 
-                    customer->drink = holder.held_item;
+// What the player's hands hold, as far as interactions go
+enum HeldKind
+{
+    HELD_NOTHING,
+    HELD_DRINK,
+    HELD_INGREDIENT,
+    HELD_PITCHER,
+    HELD_OTHER,
+    HELD_KIND_COUNT
+};
 
-                    // let customer eat
-                    customer->state = "Eating";
+constexpr int held_kind_of(uint16_t kinds)
+{
+    if (kinds & KIND_PITCHER) return HELD_PITCHER;
+    if (kinds & KIND_INGREDIENT) return HELD_INGREDIENT;
+    if (kinds & KIND_DRINK) return HELD_DRINK;
+    return HELD_OTHER;
+}
 
-                    TimerComponent& timer = registry.get<TimerComponent>(interactor.hot_item);
-                    timer.time = consume_time;
+// hot item kinds that pick the handler, the other bits only describe held items
+constexpr int TARGET_KINDS = 1 << 7;
 
-                    // remove item from hands of holder
-                    HoldableComponent& holdable = registry.get<HoldableComponent>(holder.held_item);
-                    holdable.isHeld = false;
+// The interaction rules, in order of precedence
+constexpr InteractionHandler choose_interaction(int held, int target)
+{
+    if (target & KIND_MONEY) return collect_payment;
 
-                    holder.held_item = entt::null;
+    if (held == HELD_NOTHING)
+    {
+        if (target & KIND_HOLDABLE) return pick_up;
+        if (target & KIND_STACK) return take_from_stack;
+        return nullptr;
+    }
 
-                    // set hot item to null
-                    interactor.hot_item = entt::null;
+    if (target & KIND_MACHINE) return use_coffee_machine;
+    if (target & KIND_CUSTOMER) return held == HELD_DRINK ? serve_customer : nullptr;
+    if (target & KIND_TABLE) return put_on_table;
+    if (target & KIND_DRINK) return held == HELD_PITCHER ? combine_into_drink : nullptr;
 
-                    std::cout << "Served customer with " << customer->order << "\n";
+    return nullptr;
+}
 
-                    return;
-                }
-            }
+struct InteractionTable
+{
+    InteractionHandler handlers[HELD_KIND_COUNT][TARGET_KINDS];
+};
 
-            TableComponent* table = registry.try_get<TableComponent>(interactor.hot_item);
+constexpr InteractionTable build_interaction_table()
+{
+    InteractionTable table = {};
+    for (int held = 0; held < HELD_KIND_COUNT; held++)
+        for (int target = 0; target < TARGET_KINDS; target++)
+            table.handlers[held][target] = choose_interaction(held, target);
 
-            // else if the hot item is a table,
-            if (table)
-            {
-                table->hasItemOnTop = true;
+    return table;
+}
 
-                // make table not interactable
-                InteractableComponent& i = registry.get<InteractableComponent>(interactor.hot_item);
-                i.isEnabled = false;
-                i.isHot = false;
+// every (held kind, hot item kinds) pair, worked out at compile time
+constexpr InteractionTable interaction_table = build_interaction_table();
 
-                // set held item on top of table
-                PositionComponent& table_pos = registry.get<PositionComponent>(interactor.hot_item);
-                PositionComponent& item_pos = registry.get<PositionComponent>(holder.held_item);
-                item_pos.position = table_pos.position;
+void apply_player_input(CafeWorld& world, const PlayerInput& input)
+{
+    entt::registry& registry = world.registry;
+    entt::entity player = world.player;
 
-                PlaceableComponent& placeable = registry.get<PlaceableComponent>(holder.held_item);
-                placeable.table = interactor.hot_item;
+    //MOVEMENT
+    Vector2 forces = input.forces;
 
-                // make item interactable
-                InteractableComponent& item = registry.get<InteractableComponent>(holder.held_item);
-                item.isEnabled = true;
+    AccelerationComponent& a = registry.get<AccelerationComponent>(player);
+    PhysicsComponent& p1_phy = registry.get<PhysicsComponent>(player);
+    // Does Vector - Scalar multiplication with the sum of all forces and the inverse mass of the ball
+    a.acceleration = Vector2Scale(forces, p1_phy.inverse_mass);
 
-                HoldableComponent& holdable = registry.get<HoldableComponent>(holder.held_item);
-                holdable.isHeld = false;
+    if (Vector2Length(forces) > 0)
+    {
+        DirectionComponent& dir = registry.get<DirectionComponent>(player);
+        dir.forward = Vector2Normalize(forces);
+    }
 
-                // remove item from hands of holder
-                holder.held_item = entt::null;
+    if (Vector2Length(forces) > 0 || input.interact)
+        wake_body(world, player);
 
-                // set hot item to null
-                interactor.hot_item = entt::null;
+    //INTERACT
+    InteractorComponent& interactor = registry.get<InteractorComponent>(player);
 
-                return;
-            }
+    if(input.interact && interactor.hot_item != entt::null)
+    {
+        HolderComponent& holder = registry.get<HolderComponent>(player);
 
-            DrinkComponent* drink = registry.try_get<DrinkComponent>(interactor.hot_item);
+        int held = HELD_NOTHING;
+        if (holder.held_item != entt::null)
+            held = held_kind_of(registry.get<InteractionComponent>(holder.held_item).kinds);
 
-            // else if hot item is a drink
-            if (drink)
-            {
-                IngredientComponent* ingredient = registry.try_get<IngredientComponent>(holder.held_item);
-                
-                // if holding an ingredient (inside a pitcher), and
-                // if the combination of the drink and ingredient is valid / is in the map data structure
-                if ( ingredient && ingredient->isPitcher && combine.find( std::make_pair(drink->name, ingredient->name) ) != combine.end() )
-                {
-                    std::cout << "Combined " << drink->name << " and " << ingredient->name;
+        uint16_t target = registry.get<InteractionComponent>(interactor.hot_item).kinds;
 
-                    // combine ingredient with drink
-                    drink->name = combine[std::make_pair(drink->name, ingredient->name)];
+        InteractionHandler handler = interaction_table.handlers[held][target & (TARGET_KINDS - 1)];
+        if (handler)
+            handler(world, interactor, holder);
+    }
+}
 
-                    std::cout << " into " << drink->name << "\n";
+void find_available_tables(CafeWorld& world)
+{
+    entt::registry& registry = world.registry;
 
-                    // set hot item to null
-                    interactor.hot_item = entt::null;
+    world.available_tables.clear();
 
-                    return;
-                }
-            }
-        }
+    auto dining_tables = registry.view<DiningTableComponent>();
+    for (auto entity : dining_tables)
+    {
+        DiningTableComponent& dining = registry.get<DiningTableComponent>(entity);
+        ChairComponent& chair = registry.get<ChairComponent>(dining.chair1);
+        TableComponent& table = registry.get<TableComponent>(entity);
+
+        // if no customer and nothing on the table
+        if (chair.customer == entt::null && !table.hasItemOnTop)
+            world.available_tables.push_back(entity);
     }
 }
 
-void update_customers(entt::registry& registry)
+void update_customers(CafeWorld& world)
 {
+    entt::registry& registry = world.registry;
+
+    refresh_navigation(world);
+
     int customer_count = 0;
 
     auto customers = registry.view<CustomerComponent>();
@@ -660,60 +908,52 @@ void update_customers(entt::registry& registry)
 
         if (customer.state == "Queuing")
         {
-            if (available_tables.size() > 0)
+            if (world.available_tables.size() > 0)
             {
-                std::cout << "There is a free table!\n";
+                cafe_log(world) << "There is a free table!\n";
 
                 // assign table
-                int index = GetRandomValue(0, available_tables.size());
-                customer.table = available_tables[index];
+                int index = world.random(0, world.available_tables.size() - 1);
+                customer.table = world.available_tables[index];
 
-                DiningTableComponent* dining_table = registry.try_get<DiningTableComponent>(available_tables[index]);
+                DiningTableComponent* dining_table = registry.try_get<DiningTableComponent>(world.available_tables[index]);
 
                 if (!dining_table)
                 {
-                    std::cout << "Failed to get dining table\n";
+                    cafe_log(world) << "Failed to get dining table\n";
                     continue;
                 }
 
-                std::cout << "Assigned customer to table";
-
-                // put customer on table's chair
-                PositionComponent& customer_pos = registry.get<PositionComponent>(entity);
-                PositionComponent& chair_pos = registry.get<PositionComponent>(dining_table->chair1);
-                customer_pos.position = chair_pos.position;
+                cafe_log(world) << "Assigned customer to table";
 
+                // reserve the table's chair, the customer walks there
                 ChairComponent& chair = registry.get<ChairComponent>(dining_table->chair1);
                 chair.customer = entity;
 
-                std::cout << ", teleported them to their seat";
+                cafe_log(world) << ", sent them to their seat";
 
                 // select an order and set state to ordering
-                int i = GetRandomValue(0, drinks_on_menu-1);
+                int i = world.random(0, drinks_on_menu-1);
 
-                std::cout << ", rng worked";
+                cafe_log(world) << ", rng worked";
 
                 // source: https://www.w3schools.com/cpp/cpp_exceptions.asp
                 try {
                     customer.order = drinks[i];
                 }
                 catch (...) {
-                    std::cout << ", error occurred with getting the drink\n";
+                    cafe_log(world) << ", error occurred with getting the drink\n";
                     continue;
                 }
                 
-                customer.state = "Ordering";
+                customer.state = "Seating";
 
-                std::cout << ", and customer orders " << drinks[i] << "\n";
-
-                // make customer interactable
-                InteractableComponent& interactable = registry.get<InteractableComponent>(entity);
-                interactable.isEnabled = true;
+                cafe_log(world) << ", and customer will order " << drinks[i] << "\n";
 
                 // make table unavailable
-                available_tables.erase(available_tables.begin() + index);
+                world.available_tables.erase(world.available_tables.begin() + index);
 
-                std::cout << "Table not available anymore\n";
+                cafe_log(world) << "Table not available anymore\n";
 
                 continue;
             }
@@ -725,26 +965,43 @@ void update_customers(entt::registry& registry)
                 // remove first customer in queue
                 // (they will definitely be the first to lose patience)
                 // source: https://www.w3schools.com/cpp/ref_vector_erase.asp
-                queue.erase(queue.begin());
+                world.queue.erase(world.queue.begin());
 
                 // customer leaves
                 registry.destroy(entity);
 
-                std::cout << "Customer lost patience\n";
+                cafe_log(world) << "Customer lost patience\n";
+                play_sound(world, SFX_CUSTOMER_LEAVING);
 
-                customers_not_served++;
+                world.customers_not_served++;
 
-                if (customers_not_served == fail_threshold)
+                if (world.customers_not_served == fail_threshold)
                 {
-                    std::cout << "Too many customers left\n";
+                    cafe_log(world) << "Too many customers left\n";
                     // lose
-                    button_name = "Redo Day";
+                    world.button_name = "Redo Day";
 
-                    score -= day_score;
-                    score -= 25;
+                    world.score -= world.day_score;
+                    world.score -= 25;
                 }
             }
         }
+        else if (customer.state == "Seating")
+        {
+            DiningTableComponent& dining_table = registry.get<DiningTableComponent>(customer.table);
+            PositionComponent& chair_pos = registry.get<PositionComponent>(dining_table.chair1);
+
+            if (walk_customer(world, entity, chair_pos.position))
+            {
+                customer.state = "Ordering";
+
+                // make customer interactable
+                InteractableComponent& interactable = registry.get<InteractableComponent>(entity);
+                interactable.isEnabled = true;
+
+                cafe_log(world) << "Customer sat down and orders " << customer.order << "\n";
+            }
+        }
         else if (customer.state == "Ordering")
         {
             customer.patience -= TIMESTEP;
@@ -757,40 +1014,104 @@ void update_customers(entt::registry& registry)
                 chair.customer = entt::null;
 
                 // customer leaves
-                registry.destroy(entity);
+                customer.state = "Leaving";
+
+                InteractableComponent& interactable = registry.get<InteractableComponent>(entity);
+                interactable.isEnabled = false;
+                interactable.isHot = false;
 
-                std::cout << "Customer lost patience\n";
+                cafe_log(world) << "Customer lost patience\n";
+                play_sound(world, SFX_CUSTOMER_LEAVING);
 
-                customers_not_served++;
+                world.customers_not_served++;
 
-                if (customers_not_served == fail_threshold)
+                if (world.customers_not_served == fail_threshold)
                 {
-                    std::cout << "Too many customers left\n";
+                    cafe_log(world) << "Too many customers left\n";
                     // lose
-                    button_name = "Redo Day";
+                    world.button_name = "Redo Day";
 
-                    score -= day_score;
-                    score -= 25;
+                    world.score -= world.day_score;
+                    world.score -= 25;
                 }
             }
         }
+        else if (customer.state == "Leaving")
+        {
+            if (walk_customer(world, entity, world.entrance))
+            {
+                registry.destroy(entity);
+                customer_count--;
+            }
+        }
         // else, is eating
     }
 
-    if (customer_count == 0 && customers_so_far == total_customers_today[day])
+    if (customer_count == 0 && world.customers_so_far == world.total_customers_today[world.day])
     {
         // end day / win
-        if (day == total_days)
-            button_name = "End Game";
+        if (world.day == world.total_days)
+            world.button_name = "End Game";
         else
-            button_name = "Next Day";
+            world.button_name = "Next Day";
+    }
+}
+
+// Adjusts the velocities of walking customers so they steer around other customers and the player
+void avoid_crowds(CafeWorld& world)
+{
+    entt::registry& registry = world.registry;
+    Crowd& crowd = world.crowd;
+
+    crowd.SetGrid(world.navigation.GetColumns(), world.navigation.GetRows(), GRID_SIZE);
+    crowd.Clear();
+    world.crowd_agents.clear();
+
+    auto customers = registry.view<CustomerComponent>();
+    for (auto entity : customers)
+    {
+        CustomerComponent& customer = registry.get<CustomerComponent>(entity);
+
+        // queuing customers are all waiting outside
+        if (customer.state == "Queuing") continue;
+
+        PositionComponent& pos = registry.get<PositionComponent>(entity);
+        MoveComponent& m = registry.get<MoveComponent>(entity);
+        CircleComponent& circle = registry.get<CircleComponent>(entity);
+
+        bool walking = customer.state == "Seating" || customer.state == "Leaving";
+
+        crowd.Add(pos.position.x, pos.position.y, m.velocity.x, m.velocity.y, circle.radius, walking);
+        world.crowd_agents.push_back(entity);
+    }
+
+    // customers go around the player, the player is not pushed
+    PositionComponent& player_pos = registry.get<PositionComponent>(world.player);
+    MoveComponent& player_m = registry.get<MoveComponent>(world.player);
+    crowd.Add(player_pos.position.x, player_pos.position.y, player_m.velocity.x, player_m.velocity.y,
+              registry.get<CircleComponent>(world.player).radius, false);
+    world.crowd_agents.push_back(world.player);
+
+    crowd.Avoid(customer_speed * 1.25f);
+
+    for (size_t i = 0; i < world.crowd_agents.size(); i++)
+    {
+        if (!crowd.steerable[i]) continue;
+
+        MoveComponent& m = registry.get<MoveComponent>(world.crowd_agents[i]);
+        m.velocity = {crowd.vx[i], crowd.vy[i]};
+
+        if (Vector2LengthSqr(m.velocity) > 0)
+            wake_body(world, world.crowd_agents[i]);
     }
 }
 
-void affect_velocities(entt::registry& registry)
+void affect_velocities(CafeWorld& world)
 {
+    entt::registry& registry = world.registry;
+
     // make acceleration and friction affect velocity
-    auto affect_velocity = registry.view<AccelerationComponent, PhysicsComponent>();
+    auto affect_velocity = registry.view<AccelerationComponent, PhysicsComponent>(entt::exclude<SleepingComponent>);
     for (auto entity : affect_velocity)
     {
         AccelerationComponent& a = registry.get<AccelerationComponent>(entity);
@@ -802,122 +1123,256 @@ void affect_velocities(entt::registry& registry)
     }
 }
 
-void move_entities(entt::registry& registry)
+// Moves a pushable circle (the player) without passing through obstacles, however far
+// it goes in a tick. It stops where it first touches one, bounces off it the way
+// handle_collisions would, and spends the rest of the tick moving on from there
+void sweep_circle(CafeWorld& world, entt::entity entity)
 {
-    auto move = registry.view<MoveComponent>();
-    for (auto entity : move)
+    entt::registry& registry = world.registry;
+
+    PositionComponent& pos = registry.get<PositionComponent>(entity);
+    MoveComponent& m = registry.get<MoveComponent>(entity);
+    float r = registry.get<CircleComponent>(entity).radius;
+    float inverse_mass = registry.get<PhysicsComponent>(entity).inverse_mass;
+
+    float time_left = 1.0f;
+
+    // a few contacts per tick is plenty (a corner between two counters takes two)
+    for (int contact = 0; contact < 3 && time_left > 0; contact++)
     {
-        MoveComponent& m = registry.get<MoveComponent>(entity);
+        Vector2 motion = Vector2Scale(m.velocity, TIMESTEP * time_left);
+
+        // only obstacles overlapping the bounds of the whole move
+        Vector2 middle = Vector2Add(pos.position, Vector2Scale(motion, 0.5f));
+        Vector2 reach = {fabsf(motion.x) / 2 + r, fabsf(motion.y) / 2 + r};
+
+        float first = 1.0f;
+        Body box = {Vector2Zero(), Vector2Zero(), 0.0f, 0.0f};
+
+        auto sweep = [&](Vector2 center, float half_size) {
+            float t = sweep_circle_box(pos.position, motion, r, center, half_size);
+            if (t < first)
+            {
+                first = t;
+                box.position = center;
+                box.extent = half_size;
+            }
+        };
+
+        world.tilemap.ForEachBox(Vector2Subtract(middle, reach), Vector2Add(middle, reach), sweep);
+
+        for (auto obstacle : world.loose_obstacles)
+        {
+            Vector2 center = registry.get<PositionComponent>(obstacle).position;
+            float half_size = registry.get<SquareComponent>(obstacle).half_size;
+
+            if (fabsf(center.x - middle.x) > reach.x + half_size ||
+                fabsf(center.y - middle.y) > reach.y + half_size) continue;
+
+            sweep(center, half_size);
+        }
+
+        pos.position = Vector2Add(pos.position, Vector2Scale(motion, first));
+        if (first >= 1.0f) break;
+
+        Body circle = {pos.position, m.velocity, r, inverse_mass};
+
+        Vector2 normal;
+        Contact<CircleComponent, SquareComponent>::Find(circle, box, normal);
+        resolve_contact(circle, box, normal, e);
+
+        m.velocity = circle.velocity;
+        time_left *= 1.0f - first;
+    }
+}
+
+// Moves the bodies in [begin, end) of the move storage. Every body only moves itself
+// (obstacles stand still), so any ranges can run at the same time
+void move_entities_range(CafeWorld& world, size_t begin, size_t end)
+{
+    entt::registry& registry = world.registry;
+    auto& move = registry.storage<MoveComponent>();
+
+    for (size_t i = begin; i < end; i++)
+    {
+        entt::entity entity = move.data()[i];
+        if (registry.all_of<SleepingComponent>(entity)) continue;
+
+        PhysicsComponent* phy = registry.try_get<PhysicsComponent>(entity);
+        if (phy && phy->inverse_mass > 0 && registry.all_of<CircleComponent>(entity))
+        {
+            sweep_circle(world, entity);
+            continue;
+        }
+
+        MoveComponent& m = move.get(entity);
         PositionComponent& pos = registry.get<PositionComponent>(entity);
 
         pos.position = Vector2Add(pos.position, Vector2Scale(m.velocity, TIMESTEP));
     }
 }
 
-void circle_rectangle_collision(entt::registry& registry, entt::entity& circle, entt::entity& rectangle)
+size_t count_movers(CafeWorld& world)
 {
-    // circle components
-    PhysicsComponent& c_phy = registry.get<PhysicsComponent>(circle);
-    PositionComponent& c_pos = registry.get<PositionComponent>(circle);
-    CircleComponent& c_rad = registry.get<CircleComponent>(circle);
-
-    // rectangle components
-    PhysicsComponent& r_phy = registry.get<PhysicsComponent>(rectangle);
-    PositionComponent& r_pos = registry.get<PositionComponent>(rectangle);
-    SquareComponent& r_size = registry.get<SquareComponent>(rectangle);
-
-
-    // collision proper
-    
-    // get the point on the border that is closest to the ball
-    Vector2 closestPoint = {
-        Clamp(c_pos.position.x, r_pos.position.x - r_size.half_size, r_pos.position.x + r_size.half_size),
-        Clamp(c_pos.position.y, r_pos.position.y - r_size.half_size, r_pos.position.y + r_size.half_size)
-    };
+    return world.registry.storage<MoveComponent>().size();
+}
 
-    Vector2 collisionVector = Vector2Subtract(c_pos.position, closestPoint);
-    float cvMagnitude = Vector2Length(collisionVector);
+void move_entities(CafeWorld& world)
+{
+    move_entities_range(world, 0, count_movers(world));
+}
 
-    // if distance between closest point and the ball is greater than the ball's radius,
-    // no collision
-    if (cvMagnitude > c_rad.radius) return;
+// Bounces the player off counters, tables, chairs and customers.
+// Customers have no physics: they walk their paths and nothing pushes them,
+// but they are still in the way of the player.
+// Sleeping bodies are not pushed but are still in the way, and one that a moving body
+// touches wakes up. With nothing awake to push, only the moving bodies are looked at
+void handle_collisions(CafeWorld& world)
+{
+    entt::registry& registry = world.registry;
+    Narrowphase& narrowphase = world.narrowphase;
 
-    MoveComponent* c_m = registry.try_get<MoveComponent>(circle);
-    MoveComponent* r_m = registry.try_get<MoveComponent>(rectangle);
+    narrowphase.Clear();
+    world.collision_bodies.clear();
 
-    Vector2 velocityRel = Vector2Zero();
+    bool pushable = false;
 
-    // guaranteed that at least one of circle and rectangle is moving
-    // (assuming it is not the circle moving)
+    auto circles = registry.view<CircleComponent, MoveComponent>(entt::exclude<SleepingComponent>);
+    for (auto entity : circles)
+    {
+        PhysicsComponent* phy = registry.try_get<PhysicsComponent>(entity);
+        float inverse_mass = phy ? phy->inverse_mass : 0.0f;
 
-    // if circle is moving, temporarily set relative velocity to circle's velocity
-    if (c_m)
-        velocityRel = c_m->velocity;
+        if (inverse_mass > 0) pushable = true;
 
-    // if rectangle is moving, subtract its velocity from vector stored in relative velocity
-    if (r_m)
-        velocityRel = Vector2Subtract(velocityRel, r_m->velocity);
+        narrowphase.Add<CircleComponent>({registry.get<PositionComponent>(entity).position,
+                                          registry.get<MoveComponent>(entity).velocity,
+                                          registry.get<CircleComponent>(entity).radius,
+                                          inverse_mass});
+        world.collision_bodies.push_back(entity);
+    }
 
-    float dotProduct = Vector2DotProduct(collisionVector, velocityRel);
+    // sleeping bodies that could be pushed wake up when a moving body touches them,
+    // and take part from the next tick
+    auto sleepers = registry.view<CircleComponent, PhysicsComponent, SleepingComponent>();
+    for (auto entity : sleepers)
+    {
+        if (registry.get<PhysicsComponent>(entity).inverse_mass <= 0) continue;
 
-    // if collision normal and relative velocity are towards roughly the same direction, no collision
-    if (dotProduct >= 0) return;
+        Body sleeper = {registry.get<PositionComponent>(entity).position, Vector2Zero(),
+                        registry.get<CircleComponent>(entity).radius, 0.0f};
 
-    float iNum = (1 + e) * dotProduct;
-    float iDenom = pow(cvMagnitude, 2)
-        * (c_phy.inverse_mass + r_phy.inverse_mass);
-    float impulse = -(iNum/iDenom);
+        for (const Body& body : narrowphase.bodies)
+        {
+            Vector2 normal;
+            if (Vector2LengthSqr(body.velocity) > 0 && Contact<CircleComponent, CircleComponent>::Find(sleeper, body, normal))
+            {
+                wake_body(world, entity);
+                break;
+            }
+        }
+    }
 
-    if (c_m)
+    // boxes that move
+    auto boxes = registry.view<SquareComponent, PhysicsComponent, MoveComponent>(entt::exclude<SleepingComponent>);
+    for (auto entity : boxes)
     {
-        c_m->velocity = Vector2Add(c_m->velocity, 
-            Vector2Scale(collisionVector, impulse/c_phy.mass) );
+        if (registry.get<PhysicsComponent>(entity).inverse_mass > 0) pushable = true;
+
+        narrowphase.Add<SquareComponent>({registry.get<PositionComponent>(entity).position,
+                                          registry.get<MoveComponent>(entity).velocity,
+                                          registry.get<SquareComponent>(entity).half_size,
+                                          registry.get<PhysicsComponent>(entity).inverse_mass});
+        world.collision_bodies.push_back(entity);
     }
 
-    if (r_m)
+    if (!pushable) return;
+
+    auto sleeping = registry.view<CircleComponent, MoveComponent, SleepingComponent>();
+    for (auto entity : sleeping)
     {
-        r_m->velocity = Vector2Subtract(r_m->velocity, 
-            Vector2Scale(collisionVector, impulse/r_phy.mass) );
+        narrowphase.Add<CircleComponent>({registry.get<PositionComponent>(entity).position, Vector2Zero(),
+                                          registry.get<CircleComponent>(entity).radius, 0.0f});
+        world.collision_bodies.push_back(entity);
+    }
+
+    // static boxes that are not in the tilemap
+    for (auto entity : world.loose_obstacles)
+    {
+        narrowphase.Add<SquareComponent>({registry.get<PositionComponent>(entity).position, Vector2Zero(),
+                                          registry.get<SquareComponent>(entity).half_size, 0.0f});
+        world.collision_bodies.push_back(entity);
+    }
+
+    narrowphase.FindPairs();
+    narrowphase.Resolve(e);
+
+    // the furniture in the tiles around each pushable body
+    narrowphase.ResolveStatic(world.tilemap, e);
+
+    // only pushable bodies can have changed
+    for (size_t i = 0; i < world.collision_bodies.size(); i++)
+    {
+        const Body& body = narrowphase.bodies[i];
+        if (body.inverse_mass > 0)
+            registry.get<MoveComponent>(world.collision_bodies[i]).velocity = body.velocity;
     }
 }
 
-void handle_collisions(entt::registry& registry)
+// Puts bodies to sleep once they have been still for SLEEP_TICKS ticks in a row.
+// Sleeping bodies are skipped by integration and collisions, so physics costs about
+// as much as the bodies that are actually moving (seated customers mostly sleep)
+void settle_bodies(CafeWorld& world)
 {
-    // moving circle colliding with squares
-    auto moving_physics = registry.view<PhysicsComponent, MoveComponent>();
-    auto physics = registry.view<PhysicsComponent>();
+    entt::registry& registry = world.registry;
 
-    for (auto e1 : moving_physics)
+    auto awake = registry.view<MoveComponent>(entt::exclude<SleepingComponent>);
+    for (auto entity : awake)
     {
-        // check for collisions with other physics objects
-        for (auto e2 : physics)
-        {
-            // ignore if it is the same physics object
-            if (e1 == e2)
-                continue;
+        MoveComponent& m = registry.get<MoveComponent>(entity);
+        AccelerationComponent* a = registry.try_get<AccelerationComponent>(entity);
+        StillnessComponent& stillness = registry.get_or_emplace<StillnessComponent>(entity, 0);
 
-            circle_rectangle_collision(registry, e1, e2);
+        bool still = Vector2LengthSqr(m.velocity) < SLEEP_SPEED * SLEEP_SPEED &&
+                     (!a || Vector2LengthSqr(a->acceleration) == 0);
+
+        if (!still)
+        {
+            stillness.ticks = 0;
+            continue;
         }
+
+        stillness.ticks++;
+        if (stillness.ticks < SLEEP_TICKS) continue;
+
+        m.velocity = Vector2Zero();
+        registry.emplace<SleepingComponent>(entity);
+
+        // drawn where it is from now on
+        registry.remove<PreviousPositionComponent>(entity);
     }
 }
 
-void get_hot_items(entt::registry& registry)
+void get_hot_items(CafeWorld& world)
 {
+    entt::registry& registry = world.registry;
+
     auto interactors = registry.view<InteractorComponent>();
     for (auto e : interactors)
     {
         InteractorComponent& interactor = registry.get<InteractorComponent>(e);
 
         // if there was a previous hot item, reset its status
-        if (interactor.hot_item != entt::null)
+        // (it may be gone by now, e.g. a customer that ran out of patience while hot)
+        if (interactor.hot_item != entt::null && registry.valid(interactor.hot_item))
         {
             InteractableComponent& i = registry.get<InteractableComponent>(interactor.hot_item);
             i.isHot = false;
             i.isEnabled = true;
-
-            interactor.hot_item = entt::null;
         }
 
+        interactor.hot_item = entt::null;
+
         float highest_dot = 0; // highest dot product = closest to forward direction of interactor
         float minDistance = -1;
 
@@ -966,258 +1421,297 @@ void get_hot_items(entt::registry& registry)
     }
 }
 
-void update_timers(entt::registry& registry, entt::entity& spawn_timer)
+// Seconds until the next customer arrives
+float next_arrival_gap(CafeWorld& world)
 {
-    auto timer = registry.view<TimerComponent>();
-    for (auto entity : timer)
-    {
-        TimerComponent& ent_timer = registry.get<TimerComponent>(entity);
+    size_t arrived = size_t(world.customers_so_far);
 
-        if (!FloatEquals(ent_timer.time, 0.0f))
-        {
-            ent_timer.time -= TIMESTEP;
+    // A timer that reads 0 is stopped, so a countdown must not end a hair above zero.
+    // Scheduled gaps are rounded to half a tick past a whole number of ticks
+    if (arrived > 0 && arrived <= world.arrival_gaps.size())
+        return (floorf(world.arrival_gaps[arrived - 1] / TIMESTEP) + 0.5f) * TIMESTEP;
 
-            if (ent_timer.time <= 0.0f)
-            {
-                ent_timer.time = 0.0f;
+    return (time_per_day - head_start_time) / (world.total_customers_today[world.day] - world.customers_so_far);
+}
 
-                if (entity == spawn_timer)
-                {
-                    // bring customer to queue
-                    entt::entity new_customer = registry.create();
-                    registry.emplace<CircleComponent>(new_customer, radius);
-                    registry.emplace<PositionComponent>(new_customer, Vector2{-radius, -radius});
-                    registry.emplace<MoveComponent>(new_customer, Vector2Zero());
-                    registry.emplace<DirectionComponent>(new_customer, Vector2{0.0f, 1.0f});
-                    registry.emplace<InteractableComponent>(new_customer, false, false);
-                    registry.emplace<TimerComponent>(new_customer, 0.0f);
-                    registry.emplace<CustomerComponent>(new_customer, 100.0f, "Queuing", "", entt::null, entt::null);
+// Counts down the timers in [begin, end) of the timer storage and marks the ones that
+// run out. Only touches the timers themselves, so any ranges can run at the same time
+void count_down_timers_range(CafeWorld& world, size_t begin, size_t end)
+{
+    auto& timers = world.registry.storage<TimerComponent>();
 
-                    queue.push_back(new_customer);
+    for (size_t i = begin; i < end; i++)
+    {
+        TimerComponent& timer = timers.get(timers.data()[i]);
+        if (FloatEquals(timer.time, 0.0f)) continue;
 
-                    customers_so_far++;
+        timer.time -= TIMESTEP;
 
-                    // set timer for next customer
-                    if (total_customers_today[day] - customers_so_far > 0)
-                        ent_timer.time = (time_per_day - head_start_time) / (total_customers_today[day] - customers_so_far);
+        if (timer.time <= 0.0f)
+        {
+            timer.time = 0.0f;
+            timer.rang = true;
+        }
+    }
+}
 
-                    std::cout << "Customer joined the queue\n";
+size_t count_timers(CafeWorld& world)
+{
+    return world.registry.storage<TimerComponent>().size();
+}
 
-                    continue;
-                }
+void count_down_timers(CafeWorld& world)
+{
+    count_down_timers_range(world, 0, count_timers(world));
+}
 
-                CoffeeMachineComponent* machine = registry.try_get<CoffeeMachineComponent>(entity);
-                if (machine)
-                {
-                    // espresso has been made
-                    DrinkComponent& drink = registry.get<DrinkComponent>(machine->drink);
-                    drink.name = "espresso";
+// Does what the timers that ran out this tick were waiting for (customers arriving,
+// espresso, customers finishing their drink)
+void resolve_timers(CafeWorld& world)
+{
+    entt::registry& registry = world.registry;
 
-                    // make the drink interactable
-                    InteractableComponent& drink_in = registry.get<InteractableComponent>(machine->drink);
-                    drink_in.isEnabled = true;
+    auto timer = registry.view<TimerComponent>();
+    for (auto entity : timer)
+    {
+        TimerComponent& ent_timer = registry.get<TimerComponent>(entity);
 
-                    // detach it from coffee machine setup
-                    machine->drink = entt::null;
+        if (!ent_timer.rang) continue;
+        ent_timer.rang = false;
 
-                    std::cout << "Espresso ready!\n";
+        if (entity == world.spawn_timer)
+        {
+            // bring customer to queue
+            entt::entity new_customer = registry.create();
+            registry.emplace<CircleComponent>(new_customer, radius);
+            registry.emplace<PositionComponent>(new_customer, Vector2{-radius, -radius});
+            registry.emplace<MoveComponent>(new_customer, Vector2Zero());
+            registry.emplace<DirectionComponent>(new_customer, Vector2{0.0f, 1.0f});
+            registry.emplace<InteractableComponent>(new_customer, false, false);
+            registry.emplace<TimerComponent>(new_customer, 0.0f);
+            registry.emplace<CustomerComponent>(new_customer, 100.0f, "Queuing", "", entt::null, entt::null);
+            registry.emplace<InteractionComponent>(new_customer, uint16_t(KIND_CUSTOMER));
 
-                    continue;
-                }
+            world.queue.push_back(new_customer);
 
-                CustomerComponent* customer = registry.try_get<CustomerComponent>(entity);
-                if (customer)
-                {
-                    TableComponent& table = registry.get<TableComponent>(customer->table);
-                    table.hasItemOnTop = true;
+            world.customers_so_far++;
 
-                    InteractableComponent& i = registry.get<InteractableComponent>(customer->table);
-                    i.isEnabled = false;
-                    i.isHot = false;
+            // set timer for next customer
+            if (world.total_customers_today[world.day] - world.customers_so_far > 0)
+                ent_timer.time = next_arrival_gap(world);
 
-                    PositionComponent& table_pos = registry.get<PositionComponent>(customer->table);
+            cafe_log(world) << "Customer joined the queue\n";
 
-                    // put payment on table
-                    entt::entity payment = registry.create();
-                    registry.emplace<PositionComponent>(payment, table_pos.position);
-                    registry.emplace<InteractableComponent>(payment, true, false);
-                    registry.emplace<MoneyComponent>(payment, price[customer->order] * (1.0f + customer->patience / 100.0f));
-                    registry.emplace<PlaceableComponent>(payment, customer->table);
+            continue;
+        }
 
-                    registry.emplace<SpriteComponent>(payment, coffee_tools,
-                                                        std::vector<Rectangle>{
-                                                            {32,0,16,16}
-                                                        }, 0);
-                    // destroy drink
-                    registry.destroy(customer->drink);
+        CoffeeMachineComponent* machine = registry.try_get<CoffeeMachineComponent>(entity);
+        if (machine)
+        {
+            // espresso has been made
+            DrinkComponent& drink = registry.get<DrinkComponent>(machine->drink);
+            drink.name = "espresso";
 
-                    // remove customer from chair
-                    DiningTableComponent& dining_table = registry.get<DiningTableComponent>(customer->table);
-                    ChairComponent& chair = registry.get<ChairComponent>(dining_table.chair1);
-                    chair.customer = entt::null;
+            // make the drink interactable
+            InteractableComponent& drink_in = registry.get<InteractableComponent>(machine->drink);
+            drink_in.isEnabled = true;
 
-                    // destroy customer
-                    registry.destroy(entity);
+            // detach it from coffee machine setup
+            machine->drink = entt::null;
 
-                    continue;
-                }
-            }
-        }
-    }
-}
+            cafe_log(world) << "Espresso ready!\n";
+            play_sound(world, SFX_ESPRESSO_READY);
 
-void draw_level(entt::registry& registry, entt::entity& player)
-{
-    // with sprites, do: view<sprite, __> where __ is the type of thing it is
-    // (e.g. floor, object, interactable, customer, player) or smth like that
+            continue;
+        }
 
-    // level layout
-    for (int i = 0; i < WINDOW_WIDTH / GRID_SIZE; i++)
-    {
-        for (int j = 0; j < WINDOW_HEIGHT / GRID_SIZE; j++)
+        CustomerComponent* customer = registry.try_get<CustomerComponent>(entity);
+        if (customer)
         {
-            Vector2 position = {i * GRID_SIZE, j * GRID_SIZE};
+            TableComponent& table = registry.get<TableComponent>(customer->table);
+            table.hasItemOnTop = true;
 
-            DrawLineV(position, Vector2Add(position, {GRID_SIZE, 0.0f}), BLACK);
-            DrawLineV(position, Vector2Add(position, {0.0f, GRID_SIZE}), BLACK);
-            DrawLineV(Vector2Add(position, {GRID_SIZE, GRID_SIZE}), Vector2Add(position, {GRID_SIZE, 0.0f}), BLACK);
-            DrawLineV(Vector2Add(position, {GRID_SIZE, GRID_SIZE}), Vector2Add(position, {0.0f, GRID_SIZE}), BLACK);
-        }
-    }
+            InteractableComponent& i = registry.get<InteractableComponent>(customer->table);
+            i.isEnabled = false;
+            i.isHot = false;
 
-    // obstacles
-    available_tables.clear();
+            PositionComponent& table_pos = registry.get<PositionComponent>(customer->table);
 
-    auto obstacle = registry.view<TableComponent>();
-    for (auto entity : obstacle)
-    {
-        CoffeeMachineComponent* machine = registry.try_get<CoffeeMachineComponent>(entity);
-        if (machine) continue;
+            // put payment on table
+            entt::entity payment = registry.create();
+            registry.emplace<PositionComponent>(payment, table_pos.position);
+            registry.emplace<InteractableComponent>(payment, true, false);
+            registry.emplace<MoneyComponent>(payment, price_of(customer->order) * (1.0f + customer->patience / 100.0f));
+            registry.emplace<PlaceableComponent>(payment, customer->table);
+            registry.emplace<InteractionComponent>(payment, uint16_t(KIND_MONEY));
 
-        PositionComponent& p = registry.get<PositionComponent>(entity);
-        InteractableComponent& item = registry.get<InteractableComponent>(entity);
-        SquareComponent& square = registry.get<SquareComponent>(entity);
-        ColorComponent& clr = registry.get<ColorComponent>(entity);
+            registry.emplace<SpriteComponent>(payment, coffee_tools,
+                                                std::pmr::vector<Rectangle>({
+                                                    {32,0,16,16}
+                                                }, world.day_arena.Resource()), 0);
+            // destroy drink
+            registry.destroy(customer->drink);
 
-        Color color;
-        if (item.isHot) color = BLUE;
-        else color = clr.color;
+            // remove customer from chair
+            DiningTableComponent& dining_table = registry.get<DiningTableComponent>(customer->table);
+            ChairComponent& chair = registry.get<ChairComponent>(dining_table.chair1);
+            chair.customer = entt::null;
 
-        DrawRectangleV(Vector2Subtract(p.position, {square.half_size, square.half_size}),
-                        {square.half_size * 2.0f, square.half_size * 2.0f}, color);
+            // customer walks out
+            customer->drink = entt::null;
+            customer->state = "Leaving";
 
-        DiningTableComponent* dining = registry.try_get<DiningTableComponent>(entity);
-        if (dining)
-        {
-            ChairComponent& chair = registry.get<ChairComponent>(dining->chair1);
-            TableComponent& table = registry.get<TableComponent>(entity);
+            play_sound(world, SFX_CUSTOMER_LEAVING);
 
-            // if no customer and nothing on the table
-            if (chair.customer == entt::null && !table.hasItemOnTop)
-                available_tables.push_back(entity);
+            continue;
         }
     }
+}
 
-    auto chair = registry.view<ChairComponent>();
-    for (auto entity : chair)
-    {
-        PositionComponent& p = registry.get<PositionComponent>(entity);
-        SquareComponent& square = registry.get<SquareComponent>(entity);
-
-        DrawRectangleV(Vector2Subtract(p.position, {square.half_size, square.half_size}),
-                        {square.half_size * 2.0f, square.half_size * 2.0f}, BLUE);
-    }
+// Keeps where every moving entity was before this tick, so drawing can blend
+// from there to where it ends up
+void remember_positions(CafeWorld& world)
+{
+    entt::registry& registry = world.registry;
 
-    auto machine = registry.view<CoffeeMachineComponent>();
-    for (auto entity : machine)
+    // sleeping bodies are drawn where they are
+    auto moving = registry.view<PositionComponent, MoveComponent>(entt::exclude<SleepingComponent>);
+    for (auto entity : moving)
     {
-        PositionComponent& p = registry.get<PositionComponent>(entity);
-        InteractableComponent& i = registry.get<InteractableComponent>(entity);
-
-        
-        ColorComponent& clr = registry.get<ColorComponent>(entity);
+        registry.emplace_or_replace<PreviousPositionComponent>(entity, registry.get<PositionComponent>(entity).position);
+    }
+}
 
-        Color color;
-        if (i.isHot) color = BLUE;
-        else color = clr.color;
+// Every component type, in the order of their bits in SystemAccess
+using TickComponents = std::tuple<
+    CircleComponent,
+    SquareComponent,
+    PositionComponent,
+    PreviousPositionComponent,
+    ColorComponent,
+    SpriteComponent,
+    MoveComponent,
+    AccelerationComponent,
+    PhysicsComponent,
+    StillnessComponent,
+    SleepingComponent,
+    DirectionComponent,
+    InteractableComponent,
+    InteractorComponent,
+    ChairComponent,
+    TableComponent,
+    DiningTableComponent,
+    PlaceableComponent,
+    HoldableComponent,
+    HolderComponent,
+    DrinkComponent,
+    IngredientComponent,
+    StackComponent,
+    CoffeeMachineComponent,
+    TimerComponent,
+    CustomerComponent,
+    MoneyComponent,
+    InteractionComponent
+>;
+
+template <typename T, typename Tuple>
+struct ComponentBit;
+
+template <typename T, typename... Rest>
+struct ComponentBit<T, std::tuple<T, Rest...>>
+{
+    static constexpr uint64_t value = 1;
+};
 
-        DrawRectangleV(Vector2Subtract(p.position, {GRID_SIZE * 0.375f, GRID_SIZE * 0.375f}),
-                        {GRID_SIZE * 0.75f, GRID_SIZE * 0.75f}, color);
-    }
+template <typename T, typename First, typename... Rest>
+struct ComponentBit<T, std::tuple<First, Rest...>>
+{
+    static constexpr uint64_t value = ComponentBit<T, std::tuple<Rest...>>::value << 1;
+};
 
-    // interactables
-    auto interactable = registry.view<InteractableComponent>();
-    for (auto entity : interactable)
-    {
-        CoffeeMachineComponent* machine = registry.try_get<CoffeeMachineComponent>(entity);
-        if (machine) continue;
+// bitmask of the component types
+template <typename... T>
+constexpr uint64_t components()
+{
+    return (uint64_t(0) | ... | ComponentBit<T, TickComponents>::value);
+}
 
-        CustomerComponent* customer = registry.try_get<CustomerComponent>(entity);
-        if (customer) continue;
+// What a system touches, so the scheduler (tick_scheduler.hpp) knows which systems
+// can run at the same time. A system's own scratch fields of the world (the crowd,
+// the narrowphase) do not count, nobody else uses them
+struct SystemAccess
+{
+    uint64_t reads;
+    uint64_t writes;        // values changed, or components added or removed
+    bool exclusive;         // creates or destroys entities, or changes world fields other systems read
+};
 
-        PositionComponent& p = registry.get<PositionComponent>(entity);
-        InteractableComponent& item = registry.get<InteractableComponent>(entity);
+struct TickSystem
+{
+    const char* name;
+    void (*run)(CafeWorld&);
+    SystemAccess access;
+
+    // set for systems that can be split: run is run_range over [0, count),
+    // and any ranges of that can run at the same time
+    size_t (*count)(CafeWorld&) = nullptr;
+    void (*run_range)(CafeWorld&, size_t, size_t) = nullptr;
+};
 
-        SquareComponent* square = registry.try_get<SquareComponent>(entity);
-        HoldableComponent* holdable = registry.try_get<HoldableComponent>(entity);
+// Systems of one fixed step, in the order they run
+const std::vector<TickSystem> tick_systems =
+{
+    {"remember_positions", remember_positions,
+        {components<PositionComponent, MoveComponent, SleepingComponent>(),
+         components<PreviousPositionComponent>(), false}},
 
-        // if it is not an obstacle and it is not being held
-        if (!square && (!holdable || !holdable->isHeld))
-        {
-            SpriteComponent* sprite = registry.try_get<SpriteComponent>(entity);
-            if (sprite)
-            {
-                Rectangle rec = sprite->frames[sprite->frame_number];
+    // rewrites world.available_tables, which update_customers reads
+    {"find_available_tables", find_available_tables,
+        {components<DiningTableComponent, ChairComponent, TableComponent>(), 0, true}},
 
-                DrawTexturePro(sprite->sprite_sheet, sprite->frames[sprite->frame_number],
-                                {p.position.x, p.position.y, int(item_radius), int(item_radius)},
-                                {0, 0}, 0.0f, WHITE);
+    // customers leave, and the navigation is rebuilt when the layout changed
+    {"update_customers", update_customers, {0, 0, true}},
 
-                sprite->frame_number = (sprite->frame_number + 1) & sprite->frames.size();
+    {"avoid_crowds", avoid_crowds,
+        {components<CustomerComponent, PositionComponent, MoveComponent, CircleComponent>(),
+         components<MoveComponent, SleepingComponent, StillnessComponent>(), false}},
 
-                continue;
-            }
+    {"affect_velocities", affect_velocities,
+        {components<AccelerationComponent, PhysicsComponent, MoveComponent, SleepingComponent>(),
+         components<MoveComponent>(), false}},
 
-            
-            ColorComponent& clr = registry.get<ColorComponent>(entity);
+    {"move_entities", move_entities,
+        {components<MoveComponent, SleepingComponent, PhysicsComponent, CircleComponent, SquareComponent, PositionComponent>(),
+         components<MoveComponent, PositionComponent>(), false},
+        count_movers, move_entities_range},
 
-            Color color;
-            if (item.isHot) DrawCircleV(p.position, radius / 2.0f, BLUE);
-            else DrawCircleV(p.position, radius / 2.0f, clr.color);
-        }
-    }
+    {"handle_collisions", handle_collisions,
+        {components<CircleComponent, SquareComponent, PositionComponent, MoveComponent, PhysicsComponent, SleepingComponent>(),
+         components<MoveComponent, SleepingComponent, StillnessComponent>(), false}},
 
-    // customers
-    auto customer = registry.view<CustomerComponent>();
-    for (auto entity : customer)
-    {
-        PositionComponent& pos = registry.get<PositionComponent>(entity);
-        CircleComponent& rad = registry.get<CircleComponent>(entity);
-        InteractableComponent& i = registry.get<InteractableComponent>(entity);
-        CustomerComponent& c = registry.get<CustomerComponent>(entity);
+    {"settle_bodies", settle_bodies,
+        {components<MoveComponent, AccelerationComponent, StillnessComponent, SleepingComponent>(),
+         components<MoveComponent, StillnessComponent, SleepingComponent, PreviousPositionComponent>(), false}},
 
-        if (i.isHot) DrawCircleV(pos.position, rad.radius, PURPLE);
-        else DrawCircleV(pos.position, rad.radius, DARKPURPLE);
+    {"get_hot_items", get_hot_items,
+        {components<InteractorComponent, InteractableComponent, PositionComponent, DirectionComponent>(),
+         components<InteractorComponent, InteractableComponent>(), false}},
 
-        if (c.state == "Ordering")
-            DrawText(TextFormat("%s", c.order.c_str()), pos.position.x - 10, pos.position.y - 20, 20, BLACK);
-    }
+    {"count_down_timers", count_down_timers,
+        {components<TimerComponent>(), components<TimerComponent>(), false},
+        count_timers, count_down_timers_range},
 
-    // player
-    PositionComponent& pos = registry.get<PositionComponent>(player);
-    CircleComponent& rad = registry.get<CircleComponent>(player);
-    DrawCircleV(pos.position, rad.radius, BLUE);
+    // customers arrive, payments appear
+    {"resolve_timers", resolve_timers, {0, 0, true}}
+};
 
-    //[TEMP?] draw held item
-    HolderComponent& holder = registry.get<HolderComponent>(player);
-    if (holder.held_item != entt::null)
+// One fixed step of the cafe simulation
+void simulate_tick(CafeWorld& world)
+{
+    for (const TickSystem& system : tick_systems)
     {
-        ColorComponent& clr = registry.get<ColorComponent>(holder.held_item);
-
-        DrawCircleV(Vector2Add(pos.position, {rad.radius / 1.5f, rad.radius / 1.5f}),
-                    rad.radius / 2.0f, clr.color);
+        AllocationScope scope(system.name);
+        TraceScope trace(system.name);
+        system.run(world);
     }
-
-    // score
-    DrawText(TextFormat("Score: %04i",int(score)), 300, 30, 30, BLACK);
-}
\ No newline at end of file
+}
@@ -0,0 +1,154 @@
+#ifndef INPUT_EVENTS
+#define INPUT_EVENTS
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Keyboard input as timestamped events, turned into one InputFrame per simulation tick.
+//
+// The main thread polls raylib every frame and records each press and release with
+// the time it saw it. The simulation knows the time every tick stands for, so each
+// tick gets exactly the edges that happened before it: a press is never dropped or
+// handed to two ticks, however the frame rate and tick rate line up.
+// Include after game_functions.hpp.
+
+enum InputButton
+{
+    INPUT_UP,
+    INPUT_LEFT,
+    INPUT_DOWN,
+    INPUT_RIGHT,
+    INPUT_INTERACT,
+    INPUT_BUTTON_COUNT
+};
+
+// keys for each InputButton
+const int input_keys[INPUT_BUTTON_COUNT] = {KEY_W, KEY_A, KEY_S, KEY_D, KEY_X};
+
+// Seconds on the clock input events and ticks are timed with
+double input_time()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct InputEvent
+{
+    double time;
+    uint8_t button;     // InputButton
+    bool down;          // pressed, or released
+};
+
+// The buttons during one tick, as bitmasks with a bit per InputButton
+struct InputFrame
+{
+    uint8_t held;       // down at the end of the tick
+    uint8_t pressed;    // went down during the tick
+    uint8_t released;   // went up during the tick
+};
+
+// Main thread. Turns raylib's key state into events
+class InputPoller {
+    uint8_t held = 0;
+
+public:
+    // Adds an event for every button that changed since the last poll
+    void Poll(double time, std::vector<InputEvent>& events) {
+        for (int button = 0; button < INPUT_BUTTON_COUNT; button++)
+        {
+            uint8_t bit = uint8_t(1 << button);
+            bool down = IsKeyDown(input_keys[button]);
+
+            if (down != bool(held & bit))
+                events.push_back({time, uint8_t(button), down});
+            else if (!down && IsKeyPressed(input_keys[button]))
+            {
+                // a tap shorter than a frame is up again by the time we look, keep both edges
+                events.push_back({time, uint8_t(button), true});
+                events.push_back({time, uint8_t(button), false});
+            }
+
+            held = down ? (held | bit) : (held & ~bit);
+        }
+    }
+
+    void Reset() {
+        held = 0;
+    }
+};
+
+// Simulation side. Collects events and hands out one frame per tick
+class InputTimeline {
+    std::deque<InputEvent> pending;
+    uint8_t held = 0;
+
+public:
+    void Add(const InputEvent& event) {
+        pending.push_back(event);
+    }
+
+    // Input for the tick that ends at end_time: every event up to then is applied
+    InputFrame FrameUntil(double end_time) {
+        InputFrame frame = {held, 0, 0};
+
+        while (!pending.empty() && pending.front().time <= end_time)
+        {
+            const InputEvent& event = pending.front();
+            uint8_t bit = uint8_t(1 << event.button);
+
+            if (event.down)
+            {
+                frame.pressed |= bit;
+                held |= bit;
+            }
+            else
+            {
+                frame.released |= bit;
+                held &= ~bit;
+            }
+
+            pending.pop_front();
+        }
+
+        frame.held = held;
+        return frame;
+    }
+
+    void Reset() {
+        pending.clear();
+        held = 0;
+    }
+};
+
+// What the player does during the tick the frame belongs to
+PlayerInput player_input_from(const InputFrame& frame)
+{
+    PlayerInput input = {Vector2Zero(), false};
+
+    // a button pressed and released within one tick still moves the player for that tick
+    uint8_t moving = frame.held | frame.pressed;
+
+    // Adds forces with the magnitude of 200 in the direction given by WASD inputs
+    if (moving & (1 << INPUT_UP)) {
+        input.forces = Vector2Add(input.forces, {0, -200});
+    }
+    if (moving & (1 << INPUT_LEFT)) {
+        input.forces = Vector2Add(input.forces, {-200, 0});
+    }
+    if (moving & (1 << INPUT_DOWN)) {
+        input.forces = Vector2Add(input.forces, {0, 200});
+    }
+    if (moving & (1 << INPUT_RIGHT)) {
+        input.forces = Vector2Add(input.forces, {200, 0});
+    }
+
+    input.interact = frame.pressed & (1 << INPUT_INTERACT);
+
+    return input;
+}
+
+#endif
@@ -0,0 +1,766 @@
+#ifndef LEADERBOARD
+#define LEADERBOARD
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/locking.h>
+#else
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+// One leaderboard entry, exactly as it is stored on disk
+struct LeaderboardRecord
+{
+    int32_t score;
+    uint32_t sequence;      // submission order, breaks ties (earlier submission ranks higher)
+    uint16_t season;
+    char name[6];           // up to 4 letters, null terminated, zero padded
+};
+
+static_assert(sizeof(LeaderboardRecord) == 16, "leaderboard records must stay 16 bytes on disk");
+
+// "RCLB" followed by the format version
+const char LEADERBOARD_MAGIC[4] = {'R', 'C', 'L', 'B'};
+const uint32_t LEADERBOARD_VERSION = 1;
+const size_t LEADERBOARD_HEADER_SIZE = sizeof(LEADERBOARD_MAGIC) + sizeof(LEADERBOARD_VERSION);
+
+// Journal file: "RCLJ", format version, then a generation counter that is
+// bumped every time the journal is compacted into the main store
+const char JOURNAL_MAGIC[4] = {'R', 'C', 'L', 'J'};
+const uint32_t JOURNAL_VERSION = 1;
+const long JOURNAL_HEADER_SIZE = sizeof(JOURNAL_MAGIC) + sizeof(JOURNAL_VERSION) + sizeof(uint32_t);
+
+// One journal entry: checksum of the record, then the record itself.
+// A frame whose checksum does not match was torn by a crash mid-write
+struct JournalFrame
+{
+    uint32_t checksum;
+    LeaderboardRecord record;
+};
+
+static_assert(sizeof(JournalFrame) == 20, "journal frames must stay 20 bytes on disk");
+
+// CRC-32 (IEEE), table built on first use
+uint32_t crc32(const void* data, size_t size)
+{
+    static uint32_t table[256];
+    static bool table_ready = false;
+
+    if (!table_ready)
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        table_ready = true;
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Thin wrappers over the platform file calls the journal needs
+bool lock_file(std::FILE* file)
+{
+#ifdef _WIN32
+    // locks the first byte; _LK_LOCK retries for about 10 seconds before giving up
+    long position = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    bool ok = _locking(_fileno(file), _LK_LOCK, 1) == 0;
+    std::fseek(file, position, SEEK_SET);
+    return ok;
+#else
+    return flock(fileno(file), LOCK_EX) == 0;
+#endif
+}
+
+void unlock_file(std::FILE* file)
+{
+#ifdef _WIN32
+    long position = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    _locking(_fileno(file), _LK_UNLCK, 1);
+    std::fseek(file, position, SEEK_SET);
+#else
+    flock(fileno(file), LOCK_UN);
+#endif
+}
+
+bool sync_file(std::FILE* file)
+{
+    if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool truncate_file(std::FILE* file, long size)
+{
+    std::fflush(file);
+#ifdef _WIN32
+    return _chsize(_fileno(file), size) == 0;
+#else
+    return ftruncate(fileno(file), size) == 0;
+#endif
+}
+
+// Sorted index over all records.
+// Indexable skip list: every link also stores how many entries it skips,
+// so insert, rank-of and the start of a top-k walk are all O(log n)
+class LeaderboardIndex {
+    static const int MAX_LEVEL = 24;        // enough for 4^24 entries
+
+    struct Link
+    {
+        int32_t next;       // node index, -1 for end of list
+        uint32_t span;      // number of entries this link skips over
+    };
+
+    struct Node
+    {
+        LeaderboardRecord record;
+        uint32_t first_link;    // offset into links
+        uint8_t level;
+    };
+
+    // nodes and their links live in flat arrays so millions of entries stay compact
+    std::vector<Node> nodes;
+    std::vector<Link> links;
+
+    Link head[MAX_LEVEL];
+    int level = 1;
+
+    uint32_t rng_state = 0x9E3779B9u;
+
+    int RandomLevel() {
+        int new_level = 1;
+
+        // xorshift, two bits at a time for p = 1/4
+        rng_state ^= rng_state << 13;
+        rng_state ^= rng_state >> 17;
+        rng_state ^= rng_state << 5;
+
+        uint32_t bits = rng_state;
+        while ((bits & 3) == 0 && new_level < MAX_LEVEL) {
+            new_level++;
+            bits >>= 2;
+        }
+
+        return new_level;
+    }
+
+    Link& LinkAt(int32_t node, int lvl) {
+        if (node == -1) {
+            return head[lvl];
+        }
+        return links[nodes[node].first_link + lvl];
+    }
+
+    // true if a ranks above b
+    static bool RanksAbove(const LeaderboardRecord& a, const LeaderboardRecord& b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        return a.sequence < b.sequence;
+    }
+
+public:
+    LeaderboardIndex() {
+        Clear();
+    }
+
+    void Clear() {
+        nodes.clear();
+        links.clear();
+        level = 1;
+
+        for (int i = 0; i < MAX_LEVEL; i++) {
+            head[i] = {-1, 0};
+        }
+    }
+
+    void Reserve(size_t count) {
+        nodes.reserve(count);
+        links.reserve(count + count / 3 + 1);
+    }
+
+    size_t Size() const {
+        return nodes.size();
+    }
+
+    // Inserts the record and returns its 1-based rank
+    uint32_t Insert(const LeaderboardRecord& record) {
+        int32_t update[MAX_LEVEL];
+        uint32_t rank[MAX_LEVEL];
+
+        // find the last node on each level that ranks above the new record
+        int32_t current = -1;
+        for (int i = level - 1; i >= 0; i--) {
+            rank[i] = (i == level - 1) ? 0 : rank[i + 1];
+
+            while (LinkAt(current, i).next != -1 && RanksAbove(nodes[LinkAt(current, i).next].record, record)) {
+                rank[i] += LinkAt(current, i).span;
+                current = LinkAt(current, i).next;
+            }
+
+            update[i] = current;
+        }
+
+        int new_level = RandomLevel();
+        if (new_level > level) {
+            for (int i = level; i < new_level; i++) {
+                rank[i] = 0;
+                update[i] = -1;
+                head[i].span = uint32_t(nodes.size());
+            }
+            level = new_level;
+        }
+
+        int32_t node = int32_t(nodes.size());
+        nodes.push_back({record, uint32_t(links.size()), uint8_t(new_level)});
+        links.resize(links.size() + new_level);
+
+        for (int i = 0; i < new_level; i++) {
+            Link& before = LinkAt(update[i], i);
+            Link& after = LinkAt(node, i);
+
+            after.next = before.next;
+            after.span = before.span - (rank[0] - rank[i]);
+
+            before.next = node;
+            before.span = (rank[0] - rank[i]) + 1;
+        }
+
+        // links above the new node's height now skip one more entry
+        for (int i = new_level; i < level; i++) {
+            LinkAt(update[i], i).span++;
+        }
+
+        return rank[0] + 1;
+    }
+
+    // 1-based rank a submission with this score would get right now
+    // (ties go below existing entries, since those were submitted earlier)
+    uint32_t RankOf(int32_t score) {
+        uint32_t rank = 0;
+        int32_t current = -1;
+
+        for (int i = level - 1; i >= 0; i--) {
+            while (LinkAt(current, i).next != -1 && nodes[LinkAt(current, i).next].record.score >= score) {
+                rank += LinkAt(current, i).span;
+                current = LinkAt(current, i).next;
+            }
+        }
+
+        return rank + 1;
+    }
+
+    // Calls visit(rank, record) for the entries at ranks [first, first + count), best first
+    template <typename Visitor>
+    void Walk(uint32_t first, size_t count, Visitor visit) {
+        if (first < 1 || count == 0) {
+            return;
+        }
+
+        // descend to the node right before the first requested rank
+        uint32_t rank = 0;
+        int32_t current = -1;
+        for (int i = level - 1; i >= 0; i--) {
+            while (LinkAt(current, i).next != -1 && rank + LinkAt(current, i).span < first) {
+                rank += LinkAt(current, i).span;
+                current = LinkAt(current, i).next;
+            }
+        }
+
+        // then walk the bottom level
+        current = LinkAt(current, 0).next;
+        for (size_t n = 0; n < count && current != -1; n++) {
+            rank++;
+            visit(rank, nodes[current].record);
+            current = LinkAt(current, 0).next;
+        }
+    }
+
+    std::vector<LeaderboardRecord> Top(size_t k) {
+        std::vector<LeaderboardRecord> top;
+        top.reserve(k);
+
+        Walk(1, k, [&top](uint32_t, const LeaderboardRecord& record) {
+            top.push_back(record);
+        });
+
+        return top;
+    }
+};
+
+// Leaderboard engine.
+// Submissions are appended as checksummed frames to a journal, which every
+// game instance on the machine shares under an advisory lock. Once the journal
+// grows past a threshold it is compacted into the main binary store, but only when
+// the board is opened or closed or at CompactIfDue, so a submission stays one append
+class Leaderboard {
+    LeaderboardIndex index;
+    std::string path;
+    std::string journal_path;
+    uint32_t next_sequence = 0;
+
+    std::FILE* journal = nullptr;
+    long journal_offset = 0;            // end of the last frame we have indexed
+    uint32_t journal_generation = 0;
+    size_t journal_frames = 0;
+
+    // fsync batching
+    int unsynced = 0;
+    std::chrono::steady_clock::time_point last_sync;
+
+    bool WriteHeader(std::FILE* file) {
+        return std::fwrite(LEADERBOARD_MAGIC, sizeof(LEADERBOARD_MAGIC), 1, file) == 1 &&
+               std::fwrite(&LEADERBOARD_VERSION, sizeof(LEADERBOARD_VERSION), 1, file) == 1;
+    }
+
+    bool WriteJournalHeader(uint32_t generation) {
+        std::fseek(journal, 0, SEEK_SET);
+        return std::fwrite(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC), 1, journal) == 1 &&
+               std::fwrite(&JOURNAL_VERSION, sizeof(JOURNAL_VERSION), 1, journal) == 1 &&
+               std::fwrite(&generation, sizeof(generation), 1, journal) == 1;
+    }
+
+    // Reads the generation from the journal header, or 0 if the header is missing or invalid
+    uint32_t ReadJournalGeneration() {
+        char magic[4];
+        uint32_t version = 0, generation = 0;
+
+        std::fseek(journal, 0, SEEK_SET);
+        if (std::fread(magic, sizeof(magic), 1, journal) != 1 || std::memcmp(magic, JOURNAL_MAGIC, 4) != 0 ||
+            std::fread(&version, sizeof(version), 1, journal) != 1 || version != JOURNAL_VERSION ||
+            std::fread(&generation, sizeof(generation), 1, journal) != 1) {
+            return 0;
+        }
+
+        return generation;
+    }
+
+    // Indexes a journal record
+    void Index(const LeaderboardRecord& record) {
+        // anything older than next_sequence is already in the main store
+        // (e.g. left in the journal by a compaction that crashed before truncating it)
+        if (record.sequence < next_sequence) {
+            return;
+        }
+
+        index.Insert(record);
+        next_sequence = record.sequence + 1;
+    }
+
+    // Loads the main store into the index
+    void LoadStore() {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            return;
+        }
+
+        char magic[4];
+        uint32_t version = 0;
+        if (std::fread(magic, sizeof(magic), 1, file) != 1 || std::memcmp(magic, LEADERBOARD_MAGIC, 4) != 0 ||
+            std::fread(&version, sizeof(version), 1, file) != 1 || version != LEADERBOARD_VERSION) {
+            std::cout << path << " is not a leaderboard file" << std::endl;
+            std::fclose(file);
+            return;
+        }
+
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fseek(file, long(LEADERBOARD_HEADER_SIZE), SEEK_SET);
+
+        index.Reserve((size - LEADERBOARD_HEADER_SIZE) / sizeof(LeaderboardRecord));
+
+        // read in blocks rather than one record at a time
+        std::vector<LeaderboardRecord> block(4096);
+        size_t read;
+        while ((read = std::fread(block.data(), sizeof(LeaderboardRecord), block.size(), file)) > 0) {
+            // the store is in rank order, not sequence order
+            for (size_t i = 0; i < read; i++) {
+                index.Insert(block[i]);
+                if (block[i].sequence >= next_sequence) {
+                    next_sequence = block[i].sequence + 1;
+                }
+            }
+        }
+
+        std::fclose(file);
+    }
+
+    // Indexes journal frames written since we last looked (by us or by another instance).
+    // Stops at the first torn frame and leaves journal_offset pointing at it
+    void ReadJournalTail() {
+        std::fseek(journal, journal_offset, SEEK_SET);
+
+        JournalFrame frame;
+        while (std::fread(&frame, sizeof(frame), 1, journal) == 1) {
+            if (frame.checksum != crc32(&frame.record, sizeof(frame.record))) {
+                std::cout << "Stopped at torn journal frame" << std::endl;
+                break;
+            }
+
+            Index(frame.record);
+            journal_offset += long(sizeof(frame));
+            journal_frames++;
+        }
+
+        std::clearerr(journal);
+    }
+
+    // Brings the index up to date with the files. If another instance compacted
+    // the journal since we last looked, everything is reloaded
+    void Refresh() {
+        if (!journal) {
+            return;
+        }
+
+        if (ReadJournalGeneration() != journal_generation) {
+            std::cout << "Leaderboard was compacted by another instance, reloading" << std::endl;
+
+            index.Clear();
+            next_sequence = 0;
+            journal_generation = ReadJournalGeneration();
+            journal_offset = JOURNAL_HEADER_SIZE;
+            journal_frames = 0;
+
+            LoadStore();
+        }
+
+        ReadJournalTail();
+    }
+
+    // Writes the whole index to a temporary file and swaps it in as the main store,
+    // then empties the journal. Must hold the journal lock
+    bool Compact() {
+        std::string temp_path = path + ".tmp";
+        std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+        if (!file) {
+            std::cout << "Failed to open " << temp_path << " for compaction" << std::endl;
+            return false;
+        }
+
+        bool ok = WriteHeader(file);
+
+        std::vector<LeaderboardRecord> block;
+        block.reserve(4096);
+
+        index.Walk(1, index.Size(), [&](uint32_t, const LeaderboardRecord& record) {
+            block.push_back(record);
+            if (block.size() == block.capacity()) {
+                ok = ok && std::fwrite(block.data(), sizeof(LeaderboardRecord), block.size(), file) == block.size();
+                block.clear();
+            }
+        });
+
+        if (!block.empty()) {
+            ok = ok && std::fwrite(block.data(), sizeof(LeaderboardRecord), block.size(), file) == block.size();
+        }
+
+        ok = ok && sync_file(file);
+        std::fclose(file);
+
+        if (!ok) {
+            std::cout << "Failed to write " << temp_path << std::endl;
+            std::remove(temp_path.c_str());
+            return false;
+        }
+
+        // rename over an existing file is atomic on POSIX; Windows needs the old file gone first
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            std::cout << "Failed to replace " << path << std::endl;
+            return false;
+        }
+
+        // the store now has everything; a crash from here on only leaves
+        // duplicates in the journal, which Index skips by sequence
+        journal_generation++;
+        truncate_file(journal, JOURNAL_HEADER_SIZE);
+        WriteJournalHeader(journal_generation);
+        sync_file(journal);
+
+        journal_offset = JOURNAL_HEADER_SIZE;
+        journal_frames = 0;
+        unsynced = 0;
+
+        std::cout << "Compacted " << index.Size() << " leaderboard entries" << std::endl;
+        return true;
+    }
+
+    // Reads the old human-readable leaderboard ("1. brev 08888"), skipping empty slots
+    void ImportText(const std::string& text_path) {
+        std::ifstream in(text_path);
+        std::string line;
+
+        while (getline (in, line)) {
+            size_t index0 = line.find('.');
+            if (index0 == std::string::npos) continue;
+
+            std::string sub = line.substr(index0 + 1);
+            size_t start = sub.find_first_not_of(' ');
+            if (start == std::string::npos) continue;
+            sub = sub.substr(start);
+
+            size_t index1 = sub.find(' ');
+            if (index1 == std::string::npos) continue;
+
+            try {
+                int old_score = std::stoi(sub.substr(index1 + 1));
+                Submit(sub.substr(0, index1), old_score);
+            }
+            catch (...) {
+                // "---- -----" placeholder
+            }
+        }
+    }
+
+public:
+    uint16_t season = 1;
+
+    // fsync after this many submissions, or once this much time has passed since the last sync.
+    // Submissions are always flushed to the OS, so only a power cut can lose an unsynced batch
+    int sync_batch = 8;
+    double sync_interval = 2.0;
+
+    // Journal frames allowed before they are compacted into the main store
+    // (checked on Open, Close and CompactIfDue)
+    size_t compact_threshold = 4096;
+
+    ~Leaderboard() {
+        Close();
+    }
+
+    // Loads the main store and replays the journal into the index.
+    // If neither file exists yet, the board is seeded from the old text leaderboard
+    void Open(const std::string& binary_path, const std::string& log_path, const std::string& text_path) {
+        Close();
+
+        path = binary_path;
+        journal_path = log_path;
+        index.Clear();
+        next_sequence = 0;
+        journal_frames = 0;
+
+        bool seed = false;
+
+        journal = std::fopen(journal_path.c_str(), "r+b");
+        if (!journal) {
+            journal = std::fopen(journal_path.c_str(), "w+b");
+            seed = true;
+        }
+
+        if (!journal) {
+            std::cout << "Failed to open " << journal_path << std::endl;
+            return;
+        }
+
+        lock_file(journal);
+
+        std::fseek(journal, 0, SEEK_END);
+        if (std::ftell(journal) < JOURNAL_HEADER_SIZE) {
+            // new (or never finished) journal: start at generation 1
+            truncate_file(journal, 0);
+            WriteJournalHeader(1);
+            sync_file(journal);
+        }
+
+        journal_generation = ReadJournalGeneration();
+        journal_offset = JOURNAL_HEADER_SIZE;
+
+        LoadStore();
+        seed = seed && index.Size() == 0;
+
+        ReadJournalTail();
+
+        // no one is writing while we hold the lock, so anything past the last good frame
+        // is a torn write from a crashed instance
+        std::fseek(journal, 0, SEEK_END);
+        if (std::ftell(journal) > journal_offset) {
+            std::cout << "Dropped torn tail of " << journal_path << std::endl;
+            truncate_file(journal, journal_offset);
+        }
+
+        if (journal_frames >= compact_threshold) {
+            Compact();
+        }
+
+        unlock_file(journal);
+
+        last_sync = std::chrono::steady_clock::now();
+
+        if (seed) {
+            ImportText(text_path);
+        }
+
+        std::cout << "Loaded " << index.Size() << " leaderboard entries" << std::endl;
+    }
+
+    // Compacts the journal if it has grown past the threshold. Rewrites the whole
+    // store, so call it where a stall does not matter (loading, between games)
+    void CompactIfDue() {
+        if (!journal) {
+            return;
+        }
+
+        lock_file(journal);
+        Refresh();
+
+        if (journal_frames >= compact_threshold) {
+            Compact();
+        }
+
+        unlock_file(journal);
+    }
+
+    // Syncs any batched submissions, compacts if due and releases the journal
+    void Close() {
+        if (!journal) {
+            return;
+        }
+
+        CompactIfDue();
+        Flush();
+        std::fclose(journal);
+        journal = nullptr;
+    }
+
+    // Forces batched submissions to disk
+    void Flush() {
+        if (journal && unsynced > 0) {
+            sync_file(journal);
+            unsynced = 0;
+            last_sync = std::chrono::steady_clock::now();
+        }
+    }
+
+    // Picks up submissions from other game instances
+    void Reload() {
+        if (!journal) {
+            return;
+        }
+
+        lock_file(journal);
+        Refresh();
+        unlock_file(journal);
+    }
+
+    // Appends one journal frame and indexes it. Returns the new entry's rank.
+    // Never compacts, however long the journal gets
+    uint32_t Submit(const std::string& name, int score) {
+        LeaderboardRecord record = {};
+        record.score = score;
+        record.season = season;
+        std::strncpy(record.name, name.c_str(), sizeof(record.name) - 1);
+
+        // without a journal the board still works, it just is not saved
+        if (!journal) {
+            record.sequence = next_sequence++;
+            return index.Insert(record);
+        }
+
+        lock_file(journal);
+
+        // catch up with other instances first so sequence numbers stay unique
+        Refresh();
+
+        // a crashed instance may have left half a frame behind
+        std::fseek(journal, 0, SEEK_END);
+        if (std::ftell(journal) > journal_offset) {
+            truncate_file(journal, journal_offset);
+        }
+
+        record.sequence = next_sequence;
+
+        JournalFrame frame;
+        frame.checksum = crc32(&record, sizeof(record));
+        frame.record = record;
+
+        std::fseek(journal, journal_offset, SEEK_SET);
+        if (std::fwrite(&frame, sizeof(frame), 1, journal) != 1 || std::fflush(journal) != 0) {
+            std::cout << "Failed to append to " << journal_path << std::endl;
+        }
+        else {
+            journal_offset += long(sizeof(frame));
+            journal_frames++;
+            unsynced++;
+        }
+
+        uint32_t rank = index.Insert(record);
+        next_sequence = record.sequence + 1;
+
+        double since_sync = std::chrono::duration<double>(std::chrono::steady_clock::now() - last_sync).count();
+        if (unsynced >= sync_batch || since_sync >= sync_interval) {
+            Flush();
+        }
+
+        unlock_file(journal);
+
+        return rank;
+    }
+
+    uint32_t RankOf(int score) {
+        return index.RankOf(score);
+    }
+
+    std::vector<LeaderboardRecord> Top(size_t k) {
+        return index.Top(k);
+    }
+
+    size_t Size() const {
+        return index.Size();
+    }
+
+    // Streams the leaderboard as text, one "rank. name score" line per entry.
+    // If padding is set, empty slots up to count are written as placeholders
+    void ExportText(std::ostream& out, size_t count, bool padding = false) {
+        size_t written = 0;
+
+        index.Walk(1, count, [&out, &written](uint32_t rank, const LeaderboardRecord& record) {
+            out << FormatEntry(rank, record) << "\n";
+            written++;
+        });
+
+        if (padding) {
+            for (size_t rank = written + 1; rank <= count; rank++) {
+                out << rank << ". ---- -----\n";
+            }
+        }
+    }
+
+    // "1. brev 08888"
+    static std::string FormatEntry(uint32_t rank, const LeaderboardRecord& record) {
+        char score_text[16];
+        std::snprintf(score_text, sizeof(score_text), "%05d", int(record.score));
+
+        return std::to_string(rank) + ". " + record.name + " " + score_text;
+    }
+};
+
+Leaderboard leaderboard_store;
+
+#endif
@@ -0,0 +1,304 @@
+#ifndef NARROWPHASE
+#define NARROWPHASE
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Collision response between pairs of shaped bodies.
+//
+// Every shape pair has its own contact test, picked at compile time from the
+// shape components (Contact<CircleComponent, SquareComponent> and so on).
+// Candidate pairs are sorted into one list per shape pair, and each list runs
+// through the kernel for its shapes, so no pair has to ask what it is.
+// Include after components.hpp.
+
+enum ShapeKind
+{
+    SHAPE_CIRCLE,
+    SHAPE_BOX,
+    SHAPE_KIND_COUNT
+};
+
+template <typename Shape>
+struct ShapeKindOf;
+
+template <>
+struct ShapeKindOf<CircleComponent>
+{
+    static constexpr int kind = SHAPE_CIRCLE;
+};
+
+template <>
+struct ShapeKindOf<SquareComponent>
+{
+    static constexpr int kind = SHAPE_BOX;
+};
+
+struct Body
+{
+    Vector2 position;       // center
+    Vector2 velocity;
+    float extent;           // radius of a circle, half size of a box
+    float inverse_mass;     // 0 for bodies nothing pushes (counters, customers walking their path)
+};
+
+struct BodyPair
+{
+    uint32_t a;
+    uint32_t b;
+};
+
+// Contact<A, B>::Find tells whether body a (shape A) touches body b (shape B),
+// and the direction to push a away from b along. Its length does not matter
+template <typename A, typename B>
+struct Contact;
+
+template <>
+struct Contact<CircleComponent, CircleComponent>
+{
+    static bool Find(const Body& a, const Body& b, Vector2& normal) {
+        normal = Vector2Subtract(a.position, b.position);
+        float reach = a.extent + b.extent;
+
+        return Vector2LengthSqr(normal) <= reach * reach;
+    }
+};
+
+template <>
+struct Contact<CircleComponent, SquareComponent>
+{
+    static bool Find(const Body& a, const Body& b, Vector2& normal) {
+        // get the point on the border that is closest to the ball
+        Vector2 closest = {
+            Clamp(a.position.x, b.position.x - b.extent, b.position.x + b.extent),
+            Clamp(a.position.y, b.position.y - b.extent, b.position.y + b.extent)
+        };
+
+        normal = Vector2Subtract(a.position, closest);
+
+        return Vector2LengthSqr(normal) <= a.extent * a.extent;
+    }
+};
+
+template <>
+struct Contact<SquareComponent, SquareComponent>
+{
+    static bool Find(const Body& a, const Body& b, Vector2& normal) {
+        Vector2 offset = Vector2Subtract(a.position, b.position);
+        float overlap_x = a.extent + b.extent - fabsf(offset.x);
+        float overlap_y = a.extent + b.extent - fabsf(offset.y);
+
+        // out along the axis they overlap least on
+        if (overlap_x < overlap_y)
+            normal = {copysignf(1.0f, offset.x), 0.0f};
+        else
+            normal = {0.0f, copysignf(1.0f, offset.y)};
+
+        return overlap_x >= 0 && overlap_y >= 0;
+    }
+};
+
+// Bounces the two apart along the normal, with the given restitution.
+// Bodies already moving apart are left alone
+inline void resolve_contact(Body& a, Body& b, Vector2 normal, float restitution)
+{
+    Vector2 relative = Vector2Subtract(a.velocity, b.velocity);
+    float along = Vector2DotProduct(normal, relative);
+
+    if (along >= 0) return;
+
+    float impulse = -(1 + restitution) * along / (Vector2LengthSqr(normal) * (a.inverse_mass + b.inverse_mass));
+
+    a.velocity = Vector2Add(a.velocity, Vector2Scale(normal, impulse * a.inverse_mass));
+    b.velocity = Vector2Subtract(b.velocity, Vector2Scale(normal, impulse * b.inverse_mass));
+}
+
+// Swept circle against a box. The circle's center moves from start by motion;
+// returns the fraction of the motion at which it first touches the box, or 1 if it
+// does not. A circle already touching the box is left to the contact response.
+//
+// The center hits the box grown by the radius with rounded corners: first the
+// grown box (slabs), then the corner circle if the hit is in a corner region
+inline float sweep_circle_box(Vector2 start, Vector2 motion, float radius, Vector2 center, float half_size)
+{
+    float reach = half_size + radius;
+    Vector2 from = Vector2Subtract(start, center);
+
+    float enter = 0.0f;
+    float leave = 1.0f;
+    bool inside = true;
+
+    const float s[2] = {from.x, from.y};
+    const float m[2] = {motion.x, motion.y};
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (fabsf(s[axis]) > reach) inside = false;
+
+        if (fabsf(m[axis]) < 1e-8f)
+        {
+            if (fabsf(s[axis]) > reach) return 1.0f;
+            continue;
+        }
+
+        float t1 = (-reach - s[axis]) / m[axis];
+        float t2 = (reach - s[axis]) / m[axis];
+        if (t1 > t2) std::swap(t1, t2);
+
+        enter = fmaxf(enter, t1);
+        leave = fminf(leave, t2);
+        if (enter > leave) return 1.0f;
+    }
+
+    Vector2 hit = Vector2Add(from, Vector2Scale(motion, enter));
+    bool corner = fabsf(hit.x) > half_size && fabsf(hit.y) > half_size;
+
+    // touching or overlapping the flat part of a side already
+    if (inside && !corner) return 1.0f;
+    if (!corner) return enter;
+
+    // against the corner circle: |from + motion * t - corner| = radius
+    Vector2 corner_point = {copysignf(half_size, hit.x), copysignf(half_size, hit.y)};
+    Vector2 f = Vector2Subtract(from, corner_point);
+
+    float a = Vector2DotProduct(motion, motion);
+    float b = 2.0f * Vector2DotProduct(f, motion);
+    float c = Vector2DotProduct(f, f) - radius * radius;
+
+    if (c <= 0 || a <= 0) return 1.0f;
+
+    float discriminant = b * b - 4 * a * c;
+    if (discriminant < 0) return 1.0f;
+
+    float t = (-b - sqrtf(discriminant)) / (2 * a);
+    return (t >= 0 && t <= 1) ? t : 1.0f;
+}
+
+// Every pair of one shape pair. Pairs run in order, so a body in several contacts
+// bounces off each with the velocity the previous ones left it
+template <typename A, typename B>
+void resolve_batch(std::vector<Body>& bodies, const std::vector<BodyPair>& pairs, float restitution)
+{
+    for (const BodyPair& pair : pairs)
+    {
+        Body& a = bodies[pair.a];
+        Body& b = bodies[pair.b];
+
+        Vector2 normal;
+        if (Contact<A, B>::Find(a, b, normal))
+            resolve_contact(a, b, normal, restitution);
+    }
+}
+
+// Bounces body a (shape A) off a box that does not move (a tile of the Tilemap)
+template <typename A>
+void resolve_static(Body& a, Vector2 center, float half_size, float restitution)
+{
+    Body box = {center, Vector2Zero(), half_size, 0.0f};
+
+    Vector2 normal;
+    if (Contact<A, SquareComponent>::Find(a, box, normal))
+        resolve_contact(a, box, normal, restitution);
+}
+
+typedef void (*NarrowphaseKernel)(std::vector<Body>&, const std::vector<BodyPair>&, float);
+
+// Kernels by (shape of a, shape of b). Pairs are stored with a's shape first in
+// ShapeKind order, so the lower half of the table is never used
+constexpr NarrowphaseKernel narrowphase_kernels[SHAPE_KIND_COUNT][SHAPE_KIND_COUNT] =
+{
+    {resolve_batch<CircleComponent, CircleComponent>, resolve_batch<CircleComponent, SquareComponent>},
+    {nullptr, resolve_batch<SquareComponent, SquareComponent>}
+};
+
+class Narrowphase {
+    std::vector<uint8_t> shapes;
+    std::vector<BodyPair> pairs[SHAPE_KIND_COUNT][SHAPE_KIND_COUNT];
+
+public:
+    // Bodies of this tick. Fill with Add, call Resolve, read the velocities back
+    std::vector<Body> bodies;
+
+    void Clear() {
+        bodies.clear();
+        shapes.clear();
+    }
+
+    template <typename Shape>
+    uint32_t Add(const Body& body) {
+        bodies.push_back(body);
+        shapes.push_back(uint8_t(ShapeKindOf<Shape>::kind));
+        return uint32_t(bodies.size() - 1);
+    }
+
+    // Pairs every body that can be pushed with every body whose bounds it overlaps,
+    // sorted into the list of their shape pair
+    void FindPairs() {
+        for (int i = 0; i < SHAPE_KIND_COUNT; i++)
+            for (int j = 0; j < SHAPE_KIND_COUNT; j++)
+                pairs[i][j].clear();
+
+        uint32_t count = uint32_t(bodies.size());
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (bodies[i].inverse_mass <= 0) continue;
+
+            for (uint32_t j = 0; j < count; j++)
+            {
+                // two pushable bodies are paired once
+                if (j == i || (bodies[j].inverse_mass > 0 && j < i)) continue;
+
+                float reach = bodies[i].extent + bodies[j].extent;
+                if (fabsf(bodies[i].position.x - bodies[j].position.x) > reach ||
+                    fabsf(bodies[i].position.y - bodies[j].position.y) > reach) continue;
+
+                if (shapes[i] <= shapes[j])
+                    pairs[shapes[i]][shapes[j]].push_back({i, j});
+                else
+                    pairs[shapes[j]][shapes[i]].push_back({j, i});
+            }
+        }
+    }
+
+    // Bounces every pushable body off the static boxes its bounds overlap.
+    // tiles.ForEachBox(min, max, f) hands over those boxes (Tilemap)
+    template <typename Tiles>
+    void ResolveStatic(const Tiles& tiles, float restitution) {
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            Body& body = bodies[i];
+            if (body.inverse_mass <= 0) continue;
+
+            Vector2 reach = {body.extent, body.extent};
+            Vector2 min = Vector2Subtract(body.position, reach);
+            Vector2 max = Vector2Add(body.position, reach);
+
+            if (shapes[i] == SHAPE_CIRCLE)
+                tiles.ForEachBox(min, max, [&body, restitution](Vector2 center, float half_size) {
+                    resolve_static<CircleComponent>(body, center, half_size, restitution);
+                });
+            else
+                tiles.ForEachBox(min, max, [&body, restitution](Vector2 center, float half_size) {
+                    resolve_static<SquareComponent>(body, center, half_size, restitution);
+                });
+        }
+    }
+
+    void Resolve(float restitution) {
+        for (int i = 0; i < SHAPE_KIND_COUNT; i++)
+        {
+            for (int j = i; j < SHAPE_KIND_COUNT; j++)
+            {
+                if (!pairs[i][j].empty())
+                    narrowphase_kernels[i][j](bodies, pairs[i][j], restitution);
+            }
+        }
+    }
+};
+
+#endif
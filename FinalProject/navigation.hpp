@@ -0,0 +1,234 @@
+#ifndef NAVIGATION
+#define NAVIGATION
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Flow fields over the tile grid.
+// A flow field stores, for every tile, which way to walk to reach one destination.
+// It is computed once per destination (Dijkstra over walkable tiles) and cached,
+// so any number of agents heading to the same place share it and each agent only
+// does a lookup per tick. The cache is dropped when the layout changes.
+class Navigation {
+    struct FlowField
+    {
+        std::vector<uint32_t> cost;         // cost to the destination, UNREACHABLE if there is no way
+        std::vector<Vector2> direction;     // unit vector to walk along, zero at the destination
+        uint64_t last_used = 0;
+    };
+
+    static constexpr uint32_t UNREACHABLE = 0xffffffff;
+
+    // straight steps cost 10, diagonal steps 14 (about 10 * sqrt 2)
+    static constexpr uint32_t STRAIGHT_COST = 10;
+    static constexpr uint32_t DIAGONAL_COST = 14;
+
+    int columns = 0;
+    int rows = 0;
+    float cell_size = 1.0f;
+
+    std::vector<uint8_t> walkable;
+
+    // flow fields by destination tile
+    std::unordered_map<int, FlowField> fields;
+    uint64_t lookups = 0;
+
+    // Dijkstra's open tiles, a heap kept between builds so it is not allocated every time
+    typedef std::pair<uint32_t, int> Entry;
+    std::vector<Entry> frontier;
+
+    bool Inside(int x, int y) const {
+        return x >= 0 && y >= 0 && x < columns && y < rows;
+    }
+
+    // the destination counts as walkable even if it is blocked (a chair), agents still walk onto it
+    bool Walkable(int x, int y, int destination = -1) const {
+        return Inside(x, y) && (walkable[y * columns + x] || y * columns + x == destination);
+    }
+
+    // Moving diagonally is only allowed if both tiles beside the step are free,
+    // so agents do not cut through the corners of tables
+    bool CanStep(int x, int y, int dx, int dy, int destination) const {
+        if (!Walkable(x + dx, y + dy, destination)) return false;
+        if (dx != 0 && dy != 0)
+            return Walkable(x + dx, y, destination) && Walkable(x, y + dy, destination);
+        return true;
+    }
+
+    void Build(int destination, FlowField& field) {
+        const int dx[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+        const int dy[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+        field.cost.assign(columns * rows, UNREACHABLE);
+        field.direction.assign(columns * rows, Vector2Zero());
+
+        // Dijkstra from the destination outwards
+        frontier.clear();
+
+        field.cost[destination] = 0;
+        frontier.push_back({0, destination});
+
+        while (!frontier.empty())
+        {
+            std::pop_heap(frontier.begin(), frontier.end(), std::greater<Entry>());
+            Entry current = frontier.back();
+            frontier.pop_back();
+
+            if (current.first != field.cost[current.second]) continue;
+
+            int x = current.second % columns;
+            int y = current.second / columns;
+
+            for (int i = 0; i < 8; i++)
+            {
+                // steps are symmetric, so stepping from the neighbour back to here is allowed too
+                if (!CanStep(x, y, dx[i], dy[i], destination)) continue;
+
+                int next = (y + dy[i]) * columns + (x + dx[i]);
+                uint32_t cost = current.first + (i < 4 ? STRAIGHT_COST : DIAGONAL_COST);
+
+                if (cost < field.cost[next])
+                {
+                    field.cost[next] = cost;
+                    frontier.push_back({cost, next});
+                    std::push_heap(frontier.begin(), frontier.end(), std::greater<Entry>());
+                }
+            }
+        }
+
+        // every tile points at its cheapest neighbour
+        for (int y = 0; y < rows; y++)
+        {
+            for (int x = 0; x < columns; x++)
+            {
+                int tile = y * columns + x;
+                if (tile == destination || field.cost[tile] == UNREACHABLE) continue;
+
+                uint32_t best = field.cost[tile];
+                for (int i = 0; i < 8; i++)
+                {
+                    if (!CanStep(x, y, dx[i], dy[i], destination)) continue;
+
+                    int next = (y + dy[i]) * columns + (x + dx[i]);
+                    if (field.cost[next] >= best) continue;
+
+                    best = field.cost[next];
+                    field.direction[tile] = Vector2Normalize({float(dx[i]), float(dy[i])});
+                }
+            }
+        }
+    }
+
+    // Makes room for one more field by taking out the one used longest ago.
+    // Its node is handed back so the next field can be built in its memory
+    std::unordered_map<int, FlowField>::node_type EvictOldest() {
+        auto oldest = fields.begin();
+        for (auto it = fields.begin(); it != fields.end(); ++it)
+        {
+            if (it->second.last_used < oldest->second.last_used)
+                oldest = it;
+        }
+
+        return fields.extract(oldest);
+    }
+
+public:
+    // Number of flow fields computed, for profiling
+    long fields_built = 0;
+
+    // Fields kept at most. A field costs about 12 bytes per tile, so huge
+    // layouts with thousands of chairs cannot keep one for every chair
+    size_t max_fields = 256;
+
+    Navigation() {}
+
+    Navigation(int columns, int rows, float cell_size) {
+        Resize(columns, rows, cell_size);
+    }
+
+    void Resize(int columns, int rows, float cell_size) {
+        this->columns = columns;
+        this->rows = rows;
+        this->cell_size = cell_size;
+
+        walkable.assign(columns * rows, 1);
+        fields.clear();
+    }
+
+    int GetColumns() const {
+        return columns;
+    }
+
+    int GetRows() const {
+        return rows;
+    }
+
+    // Replaces the walkable tiles. The cached fields are only dropped if something changed
+    void SetLayout(const std::vector<uint8_t>& layout) {
+        if (layout == walkable) return;
+
+        walkable = layout;
+        fields.clear();
+    }
+
+    bool IsWalkable(int x, int y) const {
+        return Walkable(x, y);
+    }
+
+    // Tile index containing the position, clamped to the grid
+    int TileAt(Vector2 position) const {
+        int x = std::min(std::max(int(floorf(position.x / cell_size)), 0), columns - 1);
+        int y = std::min(std::max(int(floorf(position.y / cell_size)), 0), rows - 1);
+        return y * columns + x;
+    }
+
+    Vector2 CenterOf(int tile) const {
+        return {(tile % columns + 0.5f) * cell_size, (tile / columns + 0.5f) * cell_size};
+    }
+
+    // Unit vector an agent at the position should walk along to reach the destination tile.
+    // Agents off the grid walk onto it first, and agents in the destination tile
+    // (or cut off from it) head straight for its center
+    Vector2 Steer(Vector2 position, int destination) {
+        int tile = TileAt(position);
+        Vector2 tile_center = CenterOf(tile);
+
+        bool off_grid = position.x < 0 || position.y < 0 ||
+                        position.x >= columns * cell_size || position.y >= rows * cell_size;
+        if (off_grid)
+            return Vector2Normalize(Vector2Subtract(tile_center, position));
+
+        auto it = fields.find(destination);
+        if (it == fields.end())
+        {
+            if (fields.size() >= max_fields && !fields.empty())
+            {
+                auto node = EvictOldest();
+                node.key() = destination;
+                it = fields.insert(std::move(node)).position;
+            }
+            else
+                it = fields.emplace(destination, FlowField()).first;
+            Build(destination, it->second);
+            fields_built++;
+        }
+
+        it->second.last_used = ++lookups;
+
+        Vector2 direction = it->second.direction[tile];
+        if (tile == destination || (direction.x == 0 && direction.y == 0))
+            return Vector2Normalize(Vector2Subtract(CenterOf(destination), position));
+
+        return direction;
+    }
+};
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef RENDER_STATE
+#define RENDER_STATE
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <string>
+#include <vector>
+
+#include "ecs_inspector.hpp"
+
+// Everything needed to draw one moment of the cafe, copied out of the world.
+// The simulation thread captures it after its ticks and the main thread draws it,
+// so drawing never touches the registry. Include after game_functions.hpp.
+
+struct DrawnRectangle
+{
+    Vector2 position;       // center
+    float half_size;
+    Color color;
+};
+
+struct DrawnSprite
+{
+    Texture texture;
+    Rectangle frame;
+    Vector2 position;
+    float size;
+};
+
+struct DrawnCircle
+{
+    Vector2 previous;       // where it was before the last tick, the same as position if it does not move
+    Vector2 position;
+    float radius;
+    Color color;
+};
+
+struct DrawnLabel
+{
+    Vector2 previous;
+    Vector2 position;
+    std::string text;
+};
+
+struct RenderState
+{
+    std::vector<DrawnRectangle> rectangles;
+    std::vector<DrawnSprite> sprites;
+    std::vector<DrawnCircle> circles;
+    std::vector<DrawnLabel> labels;
+
+    // HUD
+    float score = 0;
+    std::string button_name = "";
+    bool autopilot = false;
+    float time_warp = 1.0f;
+    float time_dilation = 1.0f;
+    bool falling_behind = false;
+
+    // memory overlay, only sampled while it is shown
+    bool show_memory = false;
+    MemoryReport memory;
+
+    // how far the next tick had come when this was captured, and when that was (seconds)
+    float alpha = 1.0f;
+    double captured_at = 0;
+};
+
+Vector2 previous_position(entt::registry& registry, entt::entity entity)
+{
+    PreviousPositionComponent* previous = registry.try_get<PreviousPositionComponent>(entity);
+    if (previous) return previous->position;
+
+    return registry.get<PositionComponent>(entity).position;
+}
+
+// Copies what draw_render_state needs. The vectors keep their capacity, so capturing
+// into the same state again does not allocate once the cafe stops growing
+void capture_render_state(CafeWorld& world, RenderState& state)
+{
+    entt::registry& registry = world.registry;
+    entt::entity player = world.player;
+
+    state.rectangles.clear();
+    state.sprites.clear();
+    state.circles.clear();
+    state.labels.clear();
+
+    // obstacles
+    auto obstacle = registry.view<TableComponent>();
+    for (auto entity : obstacle)
+    {
+        CoffeeMachineComponent* machine = registry.try_get<CoffeeMachineComponent>(entity);
+        if (machine) continue;
+
+        PositionComponent& p = registry.get<PositionComponent>(entity);
+        InteractableComponent& item = registry.get<InteractableComponent>(entity);
+        SquareComponent& square = registry.get<SquareComponent>(entity);
+        ColorComponent& clr = registry.get<ColorComponent>(entity);
+
+        state.rectangles.push_back({p.position, square.half_size, item.isHot ? BLUE : clr.color});
+    }
+
+    auto chair = registry.view<ChairComponent>();
+    for (auto entity : chair)
+    {
+        PositionComponent& p = registry.get<PositionComponent>(entity);
+        SquareComponent& square = registry.get<SquareComponent>(entity);
+
+        state.rectangles.push_back({p.position, square.half_size, BLUE});
+    }
+
+    auto machine = registry.view<CoffeeMachineComponent>();
+    for (auto entity : machine)
+    {
+        PositionComponent& p = registry.get<PositionComponent>(entity);
+        InteractableComponent& i = registry.get<InteractableComponent>(entity);
+        ColorComponent& clr = registry.get<ColorComponent>(entity);
+
+        state.rectangles.push_back({p.position, GRID_SIZE * 0.375f, i.isHot ? BLUE : clr.color});
+    }
+
+    // interactables
+    auto interactable = registry.view<InteractableComponent>();
+    for (auto entity : interactable)
+    {
+        CoffeeMachineComponent* machine = registry.try_get<CoffeeMachineComponent>(entity);
+        if (machine) continue;
+
+        CustomerComponent* customer = registry.try_get<CustomerComponent>(entity);
+        if (customer) continue;
+
+        PositionComponent& p = registry.get<PositionComponent>(entity);
+        InteractableComponent& item = registry.get<InteractableComponent>(entity);
+
+        SquareComponent* square = registry.try_get<SquareComponent>(entity);
+        HoldableComponent* holdable = registry.try_get<HoldableComponent>(entity);
+
+        // if it is not an obstacle and it is not being held
+        if (!square && (!holdable || !holdable->isHeld))
+        {
+            SpriteComponent* sprite = registry.try_get<SpriteComponent>(entity);
+            if (sprite)
+            {
+                state.sprites.push_back({sprite->sprite_sheet, sprite->frames[sprite->frame_number], p.position, item_radius});
+
+                sprite->frame_number = (sprite->frame_number + 1) % sprite->frames.size();
+
+                continue;
+            }
+
+            ColorComponent& clr = registry.get<ColorComponent>(entity);
+
+            state.circles.push_back({p.position, p.position, radius / 2.0f, item.isHot ? BLUE : clr.color});
+        }
+    }
+
+    // customers
+    auto customer = registry.view<CustomerComponent>();
+    for (auto entity : customer)
+    {
+        PositionComponent& pos = registry.get<PositionComponent>(entity);
+        CircleComponent& rad = registry.get<CircleComponent>(entity);
+        InteractableComponent& i = registry.get<InteractableComponent>(entity);
+        CustomerComponent& c = registry.get<CustomerComponent>(entity);
+
+        Vector2 previous = previous_position(registry, entity);
+
+        state.circles.push_back({previous, pos.position, rad.radius, i.isHot ? PURPLE : DARKPURPLE});
+
+        if (c.state == "Ordering")
+            state.labels.push_back({previous, pos.position, c.order});
+    }
+
+    // player
+    PositionComponent& pos = registry.get<PositionComponent>(player);
+    CircleComponent& rad = registry.get<CircleComponent>(player);
+    Vector2 previous = previous_position(registry, player);
+
+    state.circles.push_back({previous, pos.position, rad.radius, BLUE});
+
+    //[TEMP?] draw held item
+    HolderComponent& holder = registry.get<HolderComponent>(player);
+    if (holder.held_item != entt::null)
+    {
+        ColorComponent& clr = registry.get<ColorComponent>(holder.held_item);
+        Vector2 offset = {rad.radius / 1.5f, rad.radius / 1.5f};
+
+        state.circles.push_back({Vector2Add(previous, offset), Vector2Add(pos.position, offset), rad.radius / 2.0f, clr.color});
+    }
+
+    state.score = world.score;
+    state.button_name = world.button_name;
+}
+
+// Draws the captured cafe with moving things alpha of the way from their previous position
+void draw_render_state(const RenderState& state, float alpha)
+{
+    // level layout
+    for (int i = 0; i < WINDOW_WIDTH / GRID_SIZE; i++)
+    {
+        for (int j = 0; j < WINDOW_HEIGHT / GRID_SIZE; j++)
+        {
+            Vector2 position = {i * GRID_SIZE, j * GRID_SIZE};
+
+            DrawLineV(position, Vector2Add(position, {GRID_SIZE, 0.0f}), BLACK);
+            DrawLineV(position, Vector2Add(position, {0.0f, GRID_SIZE}), BLACK);
+            DrawLineV(Vector2Add(position, {GRID_SIZE, GRID_SIZE}), Vector2Add(position, {GRID_SIZE, 0.0f}), BLACK);
+            DrawLineV(Vector2Add(position, {GRID_SIZE, GRID_SIZE}), Vector2Add(position, {0.0f, GRID_SIZE}), BLACK);
+        }
+    }
+
+    for (const DrawnRectangle& rectangle : state.rectangles)
+    {
+        DrawRectangleV(Vector2Subtract(rectangle.position, {rectangle.half_size, rectangle.half_size}),
+                        {rectangle.half_size * 2.0f, rectangle.half_size * 2.0f}, rectangle.color);
+    }
+
+    for (const DrawnSprite& sprite : state.sprites)
+    {
+        DrawTexturePro(sprite.texture, sprite.frame,
+                        {sprite.position.x, sprite.position.y, sprite.size, sprite.size},
+                        {0, 0}, 0.0f, WHITE);
+    }
+
+    for (const DrawnCircle& circle : state.circles)
+    {
+        DrawCircleV(Vector2Lerp(circle.previous, circle.position, alpha), circle.radius, circle.color);
+    }
+
+    for (const DrawnLabel& label : state.labels)
+    {
+        Vector2 position = Vector2Lerp(label.previous, label.position, alpha);
+        DrawText(label.text.c_str(), position.x - 10, position.y - 20, 20, BLACK);
+    }
+
+    // score
+    DrawText(TextFormat("Score: %04i", int(state.score)), 300, 30, 30, BLACK);
+}
+
+#endif
@@ -2,12 +2,17 @@
 
 #include "scene_manager.hpp"
 #include "all_scenes.hpp"
+#include "audio_thread.hpp"
 
 int main() {
+    trace_thread_name("main");
+
     InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Random Cafe");
 
     InitAudioDevice();
 
+    leaderboard_store.Open("leaderboard.bin", "leaderboard.journal", "leaderboard.txt");
+
     SceneManager scene_manager;
 
     TitleScene title_scene;
@@ -45,56 +50,87 @@ int main() {
 
     scene_manager.SwitchScene(0);
 
-    Music main = LoadMusicStream("main.mp3");
+    // sound effects are decoded once, up front, and mixed on the audio thread
+    SamplePool sound_effects;
+    sound_effects.Load();
+
+    // the music streams on its own thread, the loop only tells it to play or stop
+    AudioThread music;
+    music.Start("main.mp3", &sound_effects);
 
-    float time_played = 0.0f;
-    bool play_music;
+    // the simulation fires the effects straight into the audio thread's queue
+    cafe.sounds = &music.Effects();
+
+    bool music_on = false;
 
     while(!WindowShouldClose()) {
+        TraceScope frame_trace("frame");
+
        Scene* active_scene = scene_manager.GetActiveScene();
 
-        play_music = settings_scene.play_music;
+        // F4 starts a trace, pressing it again writes it out
+        if (IsKeyPressed(KEY_F4)) {
+            if (tracing) {
+                stop_tracing("trace.json");
+            }
+            else {
+                start_tracing();
+            }
+        }
 
         BeginDrawing();
         ClearBackground(Color{221, 161, 94, 255});
 
-        if (active_scene != nullptr) {
-            active_scene->Update();
-            active_scene->Draw();
-        }
+        scene_manager.Update();
+        active_scene = scene_manager.GetActiveScene();
 
-        if (play_music) {
-            if (!IsMusicStreamPlaying(main)) {
-                PlayMusicStream(main);
-            }
+        // while a switch waits on its assets, show progress instead of the old scene
+        if (scene_manager.IsSwitching()) {
+            scene_manager.DrawLoading();
         }
-        else {
-            if (IsMusicStreamPlaying(main)) {
-                StopMusicStream(main);
+        else if (active_scene != nullptr) {
+            {
+                TraceScope trace("Scene::Update");
+                active_scene->Update();
+            }
+            {
+                TraceScope trace("Scene::Draw");
+                active_scene->Draw();
             }
         }
 
-        if (IsMusicStreamPlaying(main)){
-            UpdateMusicStream(main);
+        // the music plays through once, then the setting turns itself off
+        if (music.TakeFinished()) {
+            settings_scene.play_music = false;
+            music_on = false;
         }
 
-        time_played = GetMusicTimePlayed(main)/GetMusicTimeLength(main);
-
-        if (time_played > 1.0f){
-            time_played = 0.0f;
-            StopMusicStream(main);
-            settings_scene.play_music = false;
-        } 
+        // a command that does not fit in the queue is sent again next frame
+        if (settings_scene.play_music != music_on) {
+            if (music.Send({settings_scene.play_music ? AUDIO_PLAY : AUDIO_STOP, 0.0f})) {
+                music_on = settings_scene.play_music;
+            }
+        }
 
+        TraceScope end_trace("EndDrawing");
         EndDrawing();
     }
 
+    if (tracing) {
+        stop_tracing("trace.json");
+    }
+
     Scene* active_scene = scene_manager.GetActiveScene();
     if (active_scene != nullptr) {
         active_scene->End();
     }
 
-    UnloadMusicStream(main);
+    cafe.sounds = nullptr;
+    music.Stop();
+
+    leaderboard_store.Close();
+
+    autosave.Stop();
 
     ResourceManager::GetInstance()->UnloadAllTextures();
     
@@ -0,0 +1,651 @@
+#ifndef SAVE_STATE
+#define SAVE_STATE
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Binary snapshots of the whole world: every component storage in the registry
+// plus the rest of the cafe's state (CafeWorld in game_functions.hpp).
+//
+// Taking a snapshot only copies component arrays (cheap, main thread).
+// Writing it to disk happens on a background thread, see Autosave below.
+
+const char SNAPSHOT_MAGIC[4] = {'R', 'C', 'S', 'V'};
+const uint32_t SNAPSHOT_VERSION = 3;
+const std::string AUTOSAVE_PATH = "autosave.bin";
+
+// Every component type that is saved. Add new components here
+using SavedComponents = std::tuple<
+    CircleComponent,
+    SquareComponent,
+    PositionComponent,
+    ColorComponent,
+    SpriteComponent,
+    MoveComponent,
+    AccelerationComponent,
+    PhysicsComponent,
+    DirectionComponent,
+    InteractableComponent,
+    InteractorComponent,
+    ChairComponent,
+    TableComponent,
+    DiningTableComponent,
+    PlaceableComponent,
+    HoldableComponent,
+    HolderComponent,
+    DrinkComponent,
+    IngredientComponent,
+    StackComponent,
+    CoffeeMachineComponent,
+    TimerComponent,
+    CustomerComponent,
+    MoneyComponent,
+    InteractionComponent
+>;
+
+// One component storage, copied out of the registry as two parallel arrays
+template <typename T>
+struct ComponentColumn
+{
+    std::vector<entt::entity> entities;
+    std::vector<T> values;
+};
+
+template <typename Tuple>
+struct ColumnsOf;
+
+template <typename... T>
+struct ColumnsOf<std::tuple<T...>>
+{
+    using type = std::tuple<ComponentColumn<T>...>;
+};
+
+// Everything in CafeWorld besides the registry
+struct GameStateSnapshot
+{
+    entt::entity player;
+    entt::entity spawn_timer;
+    std::vector<entt::entity> queue;
+    std::vector<entt::entity> available_tables;
+
+    int day;
+    float score;
+    float day_score;
+    int customers_not_served;
+    float customers_so_far;
+    float brew_time;
+    float consume_time;
+    std::string button_name;
+};
+
+struct WorldSnapshot
+{
+    typename ColumnsOf<SavedComponents>::type columns;
+    GameStateSnapshot state;
+
+    // texture id -> path, so sprites can be reloaded in another run
+    std::vector<std::pair<unsigned int, std::string>> texture_paths;
+
+    // every entity alive at capture, sorted. Only kept in memory, for restore_day_start
+    std::vector<entt::entity> alive;
+};
+
+// Calls f on every column of the snapshot
+template <typename F>
+void for_each_column(WorldSnapshot& snapshot, F f)
+{
+    std::apply([&f](auto&... column) { (f(column), ...); }, snapshot.columns);
+}
+
+// CAPTURE / RESTORE
+
+template <typename T>
+void capture_column(entt::registry& registry, ComponentColumn<T>& column)
+{
+    // clear keeps capacity, so after the first few snapshots this does not allocate
+    // (apart from strings inside components)
+    column.entities.clear();
+    column.values.clear();
+
+    // in packed order (views walk backwards), so inserting the column back keeps
+    // the storage in the order the systems saw it
+    auto& storage = registry.storage<T>();
+    column.entities.assign(storage.data(), storage.data() + storage.size());
+    column.values.reserve(storage.size());
+
+    for (entt::entity entity : column.entities)
+        column.values.push_back(storage.get(entity));
+}
+
+// Copies the registry and the rest of the world into the snapshot
+void capture_world(CafeWorld& world, WorldSnapshot& snapshot)
+{
+    entt::registry& registry = world.registry;
+
+    for_each_column(snapshot, [&registry](auto& column) {
+        capture_column(registry, column);
+    });
+
+    GameStateSnapshot& state = snapshot.state;
+    state.player = world.player;
+    state.spawn_timer = world.spawn_timer;
+    state.queue.assign(world.queue.begin(), world.queue.end());
+    state.available_tables.assign(world.available_tables.begin(), world.available_tables.end());
+    state.day = world.day;
+    state.score = world.score;
+    state.day_score = world.day_score;
+    state.customers_not_served = world.customers_not_served;
+    state.customers_so_far = world.customers_so_far;
+    state.brew_time = world.brew_time;
+    state.consume_time = world.consume_time;
+    state.button_name = world.button_name;
+
+    const auto& entities = registry.storage<entt::entity>();
+    snapshot.alive.assign(entities.data(), entities.data() + entities.in_use());
+    std::sort(snapshot.alive.begin(), snapshot.alive.end());
+
+    snapshot.texture_paths.clear();
+    for (const SpriteComponent& sprite : std::get<ComponentColumn<SpriteComponent>>(snapshot.columns).values)
+    {
+        bool known = false;
+        for (auto& it : snapshot.texture_paths)
+            if (it.first == sprite.sprite_sheet.id) known = true;
+
+        if (known) continue;
+
+        // a texture the world does not know is saved without a path
+        std::string path = "";
+        for (auto& it : world.texture_paths)
+            if (it.first == sprite.sprite_sheet.id) path = it.second;
+
+        snapshot.texture_paths.push_back({sprite.sprite_sheet.id, path});
+    }
+}
+
+// Replaces the registry contents and the rest of the world with the snapshot.
+// Entities keep their ids, so entity references inside components stay valid
+void restore_world(CafeWorld& world, WorldSnapshot& snapshot)
+{
+    entt::registry& registry = world.registry;
+
+    registry.clear();
+
+    // recreate every entity with its saved id
+    std::vector<entt::entity> entities;
+    for_each_column(snapshot, [&entities](auto& column) {
+        entities.insert(entities.end(), column.entities.begin(), column.entities.end());
+    });
+
+    std::sort(entities.begin(), entities.end());
+    entities.erase(std::unique(entities.begin(), entities.end()), entities.end());
+
+    for (entt::entity entity : entities)
+    {
+        entt::entity created = registry.create(entity);
+        if (created != entity)
+            std::cout << "Restored entity " << entt::to_integral(entity) << " with a different id\n";
+    }
+
+    // bulk insert each storage
+    for_each_column(snapshot, [&registry](auto& column) {
+        using T = typename std::decay_t<decltype(column.values)>::value_type;
+        registry.insert<T>(column.entities.begin(), column.entities.end(), column.values.begin());
+    });
+
+    GameStateSnapshot& state = snapshot.state;
+    world.player = state.player;
+    world.spawn_timer = state.spawn_timer;
+    world.queue.assign(state.queue.begin(), state.queue.end());
+    world.available_tables.assign(state.available_tables.begin(), state.available_tables.end());
+    world.day = state.day;
+    world.score = state.score;
+    world.day_score = state.day_score;
+    world.customers_not_served = state.customers_not_served;
+    world.customers_so_far = state.customers_so_far;
+    world.brew_time = state.brew_time;
+    world.consume_time = state.consume_time;
+    world.button_name = state.button_name;
+
+    world.navigation_dirty = true;
+}
+
+// Puts the registry back to how it was when the snapshot was taken, without tearing
+// down the level's entities: anything created since is destroyed, and every saved
+// storage is emptied and gets its column inserted back in bulk, which also drops
+// components the level's entities picked up during the day.
+// The rest of the world is left alone, since score and day carry over between days
+void restore_day_start(entt::registry& registry, WorldSnapshot& snapshot)
+{
+    // everything that was not there at the start of the day (customers, cups, payments)
+    std::vector<entt::entity> created;
+    const auto& entities = registry.storage<entt::entity>();
+    for (size_t i = 0; i < entities.in_use(); i++)
+    {
+        entt::entity entity = entities.data()[i];
+        if (!std::binary_search(snapshot.alive.begin(), snapshot.alive.end(), entity))
+            created.push_back(entity);
+    }
+
+    registry.destroy(created.begin(), created.end());
+
+    for_each_column(snapshot, [&registry](auto& column) {
+        using T = typename std::decay_t<decltype(column.values)>::value_type;
+        registry.clear<T>();
+        registry.insert<T>(column.entities.begin(), column.entities.end(), column.values.begin());
+    });
+
+    // not saved: positions jumped back, so there is nothing to blend from, and everything starts awake
+    registry.clear<PreviousPositionComponent>();
+    registry.clear<SleepingComponent, StillnessComponent>();
+}
+
+// SERIALIZATION
+
+void write_raw(std::ostream& out, const void* data, size_t size)
+{
+    out.write(static_cast<const char*>(data), std::streamsize(size));
+}
+
+bool read_raw(std::istream& in, void* data, size_t size)
+{
+    in.read(static_cast<char*>(data), std::streamsize(size));
+    return bool(in);
+}
+
+template <typename T>
+void write_pod(std::ostream& out, const T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "write_pod needs a trivially copyable type");
+    write_raw(out, &value, sizeof(T));
+}
+
+template <typename T>
+bool read_pod(std::istream& in, T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "read_pod needs a trivially copyable type");
+    return read_raw(in, &value, sizeof(T));
+}
+
+void write_string(std::ostream& out, const std::string& value)
+{
+    write_pod(out, uint32_t(value.size()));
+    write_raw(out, value.data(), value.size());
+}
+
+bool read_string(std::istream& in, std::string& value)
+{
+    uint32_t size = 0;
+    if (!read_pod(in, size)) return false;
+    value.resize(size);
+    return read_raw(in, &value[0], size);
+}
+
+template <typename T, typename Allocator>
+void write_array(std::ostream& out, const std::vector<T, Allocator>& values)
+{
+    write_pod(out, uint32_t(values.size()));
+    write_raw(out, values.data(), values.size() * sizeof(T));
+}
+
+template <typename T, typename Allocator>
+bool read_array(std::istream& in, std::vector<T, Allocator>& values)
+{
+    uint32_t size = 0;
+    if (!read_pod(in, size)) return false;
+    values.resize(size);
+    return read_raw(in, values.data(), size * sizeof(T));
+}
+
+// components that own heap memory are written field by field
+
+void write_value(std::ostream& out, const SpriteComponent& sprite)
+{
+    write_pod(out, sprite.sprite_sheet.id);         // resolved to a path through texture_paths
+    write_array(out, sprite.frames);
+    write_pod(out, sprite.frame_number);
+}
+
+bool read_value(std::istream& in, SpriteComponent& sprite)
+{
+    sprite.sprite_sheet = {};
+    return read_pod(in, sprite.sprite_sheet.id) && read_array(in, sprite.frames) && read_pod(in, sprite.frame_number);
+}
+
+void write_value(std::ostream& out, const DrinkComponent& drink)
+{
+    write_string(out, drink.name);
+}
+
+bool read_value(std::istream& in, DrinkComponent& drink)
+{
+    return read_string(in, drink.name);
+}
+
+void write_value(std::ostream& out, const IngredientComponent& ingredient)
+{
+    write_string(out, ingredient.name);
+    write_pod(out, ingredient.isPitcher);
+}
+
+bool read_value(std::istream& in, IngredientComponent& ingredient)
+{
+    return read_string(in, ingredient.name) && read_pod(in, ingredient.isPitcher);
+}
+
+void write_value(std::ostream& out, const StackComponent& stack)
+{
+    write_string(out, stack.type);
+}
+
+bool read_value(std::istream& in, StackComponent& stack)
+{
+    return read_string(in, stack.type);
+}
+
+void write_value(std::ostream& out, const CustomerComponent& customer)
+{
+    write_pod(out, customer.patience);
+    write_string(out, customer.state);
+    write_string(out, customer.order);
+    write_pod(out, customer.table);
+    write_pod(out, customer.drink);
+}
+
+bool read_value(std::istream& in, CustomerComponent& customer)
+{
+    return read_pod(in, customer.patience) && read_string(in, customer.state) && read_string(in, customer.order) &&
+           read_pod(in, customer.table) && read_pod(in, customer.drink);
+}
+
+template <typename T>
+void write_column(std::ostream& out, const ComponentColumn<T>& column)
+{
+    write_array(out, column.entities);
+
+    // plain data goes out as one block
+    if constexpr (std::is_trivially_copyable<T>::value)
+    {
+        write_array(out, column.values);
+    }
+    else
+    {
+        write_pod(out, uint32_t(column.values.size()));
+        for (const T& value : column.values)
+            write_value(out, value);
+    }
+}
+
+template <typename T>
+bool read_column(std::istream& in, ComponentColumn<T>& column)
+{
+    if (!read_array(in, column.entities)) return false;
+
+    if constexpr (std::is_trivially_copyable<T>::value)
+    {
+        if (!read_array(in, column.values)) return false;
+    }
+    else
+    {
+        uint32_t size = 0;
+        if (!read_pod(in, size)) return false;
+
+        column.values.resize(size);
+        for (T& value : column.values)
+            if (!read_value(in, value)) return false;
+    }
+
+    return column.entities.size() == column.values.size();
+}
+
+// Writes to a temporary file first, so a crash mid-write never destroys the previous save
+bool write_snapshot(const WorldSnapshot& snapshot, const std::string& path)
+{
+    std::string temp_path = path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        std::cout << "Failed to open " << temp_path << "\n";
+        return false;
+    }
+
+    write_raw(out, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    write_pod(out, SNAPSHOT_VERSION);
+    write_pod(out, uint32_t(std::tuple_size<SavedComponents>::value));
+
+    const GameStateSnapshot& state = snapshot.state;
+    write_pod(out, state.player);
+    write_pod(out, state.spawn_timer);
+    write_array(out, state.queue);
+    write_array(out, state.available_tables);
+    write_pod(out, state.day);
+    write_pod(out, state.score);
+    write_pod(out, state.day_score);
+    write_pod(out, state.customers_not_served);
+    write_pod(out, state.customers_so_far);
+    write_pod(out, state.brew_time);
+    write_pod(out, state.consume_time);
+    write_string(out, state.button_name);
+
+    write_pod(out, uint32_t(snapshot.texture_paths.size()));
+    for (auto& it : snapshot.texture_paths)
+    {
+        write_pod(out, it.first);
+        write_string(out, it.second);
+    }
+
+    std::apply([&out](const auto&... column) { (write_column(out, column), ...); }, snapshot.columns);
+
+    out.close();
+    if (!out)
+    {
+        std::cout << "Failed to write " << temp_path << "\n";
+        return false;
+    }
+
+    std::remove(path.c_str());
+    return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+bool read_snapshot(WorldSnapshot& snapshot, const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    char magic[4];
+    uint32_t version = 0, component_count = 0;
+    if (!read_raw(in, magic, sizeof(magic)) || std::memcmp(magic, SNAPSHOT_MAGIC, 4) != 0 ||
+        !read_pod(in, version) || version != SNAPSHOT_VERSION ||
+        !read_pod(in, component_count) || component_count != std::tuple_size<SavedComponents>::value)
+    {
+        std::cout << path << " is not a compatible save\n";
+        return false;
+    }
+
+    GameStateSnapshot& state = snapshot.state;
+    bool ok = read_pod(in, state.player) && read_pod(in, state.spawn_timer) &&
+              read_array(in, state.queue) && read_array(in, state.available_tables) &&
+              read_pod(in, state.day) && read_pod(in, state.score) && read_pod(in, state.day_score) &&
+              read_pod(in, state.customers_not_served) && read_pod(in, state.customers_so_far) &&
+              read_pod(in, state.brew_time) && read_pod(in, state.consume_time) &&
+              read_string(in, state.button_name);
+
+    uint32_t texture_count = 0;
+    ok = ok && read_pod(in, texture_count);
+    snapshot.texture_paths.resize(ok ? texture_count : 0);
+    for (auto& it : snapshot.texture_paths)
+        ok = ok && read_pod(in, it.first) && read_string(in, it.second);
+
+    for_each_column(snapshot, [&in, &ok](auto& column) {
+        ok = ok && read_column(in, column);
+    });
+
+    if (!ok)
+    {
+        std::cout << path << " is truncated or corrupt\n";
+        return false;
+    }
+
+    // texture ids differ between runs, so reload sprites by path
+    for (SpriteComponent& sprite : std::get<ComponentColumn<SpriteComponent>>(snapshot.columns).values)
+    {
+        for (auto& it : snapshot.texture_paths)
+        {
+            if (it.first == sprite.sprite_sheet.id && it.second != "")
+                sprite.sprite_sheet = ResourceManager::GetInstance()->GetTexture(it.second);
+        }
+    }
+
+    return true;
+}
+
+// Loads a save file straight into the world
+bool load_world(CafeWorld& world, const std::string& path)
+{
+    WorldSnapshot snapshot;
+    if (!read_snapshot(snapshot, path)) return false;
+
+    restore_world(world, snapshot);
+
+    std::cout << "Loaded day " << world.day << " from " << path << "\n";
+    return true;
+}
+
+// Periodic autosave.
+// The main thread copies the world into one of two snapshot buffers and hands it
+// to a writer thread, which serializes it while the game keeps running on the other buffer
+class Autosave {
+    WorldSnapshot buffers[2];
+    int capture_index = 0;          // buffer the main thread captures into next
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+
+    WorldSnapshot* to_write = nullptr;
+    bool writing = false;
+    bool stopping = false;
+
+    float timer = 0.0f;
+
+    void WriterLoop() {
+        trace_thread_name("autosave");
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (true)
+        {
+            wake.wait(lock, [this]() { return stopping || to_write != nullptr; });
+
+            if (to_write == nullptr && stopping)
+                return;
+
+            WorldSnapshot* snapshot = to_write;
+            to_write = nullptr;
+            writing = true;
+
+            lock.unlock();
+            bool ok;
+            {
+                TraceScope trace("write_snapshot");
+                ok = write_snapshot(*snapshot, path);
+            }
+            lock.lock();
+
+            writing = false;
+
+            if (!ok)
+                std::cout << "Autosave failed\n";
+        }
+    }
+
+public:
+    std::string path = AUTOSAVE_PATH;
+    float interval = 10.0f;         // seconds between autosaves
+
+    ~Autosave() {
+        Stop();
+    }
+
+    // Captures the world and queues it for writing.
+    // Skipped (returns false) if the previous save is still queued, since the writer
+    // may then still be busy with the buffer we would capture into
+    bool Save(CafeWorld& world) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (to_write != nullptr)
+                return false;
+
+            if (!writer.joinable())
+                writer = std::thread(&Autosave::WriterLoop, this);
+        }
+
+        // the writer is idle or busy with the other buffer, so capture without the lock
+        WorldSnapshot& snapshot = buffers[capture_index];
+        {
+            TraceScope trace("capture_world");
+            capture_world(world, snapshot);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            to_write = &snapshot;
+        }
+        wake.notify_one();
+
+        capture_index = 1 - capture_index;
+        return true;
+    }
+
+    // Call once per frame while a day is in progress
+    void Update(CafeWorld& world, float delta_time) {
+        timer += delta_time;
+
+        if (timer >= interval && Save(world))
+            timer = 0.0f;
+    }
+
+    void ResetTimer() {
+        timer = 0.0f;
+    }
+
+    // Finishes any pending write and stops the writer thread
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+
+        if (writer.joinable())
+            writer.join();
+
+        stopping = false;
+    }
+};
+
+Autosave autosave;
+
+// set by the title screen so GameScene resumes the saved day instead of starting a new one
+bool continue_from_autosave = false;
+
+// set when switching to GameScene should start a fresh day rather than resume the current one
+bool start_new_day = true;
+
+// the level as it was at the start of the first day. Every later day (and every redo)
+// starts by restoring this instead of rebuilding the level
+WorldSnapshot day_start;
+bool level_built = false;
+
+#endif
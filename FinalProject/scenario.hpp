@@ -0,0 +1,226 @@
+#ifndef SCENARIO
+#define SCENARIO
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// Synthetic cafes for stress tests.
+// A scenario has any number of counters, dining tables and stations, and customers
+// arriving by a chosen process. It is built with the same create_* functions as the
+// real level, so every system runs on a normal world, just a bigger one.
+// Include after game_functions.hpp.
+
+enum class ArrivalProcess
+{
+    Even,       // spread evenly over the day
+    Poisson,    // random arrivals at a constant rate
+    Bursts,     // groups arriving together
+    RushHour    // a rate that peaks in the middle of the day
+};
+
+struct Scenario
+{
+    int columns = 16;               // width in tiles, the rows follow from what has to fit
+    int counters = 1;               // free counters to put things on
+    int dining_tables = 5;
+    int stations = 1;               // cups, coffee machine, beans, water, kettle and milk, a counter each
+    int customers = 18;             // arrivals over the day, before intensity
+    float intensity = 1.0f;         // multiplies the number of customers
+    ArrivalProcess arrivals = ArrivalProcess::Even;
+    float day_length = time_per_day - head_start_time;
+    float burst_size = 6.0f;        // mean customers per burst
+    float rush_peak = 4.0f;         // arrival rate at the peak of the rush, relative to the base rate
+    unsigned seed = 1;
+};
+
+// Today's biggest day times the scale, on a roughly square floor
+Scenario scaled_scenario(int scale, ArrivalProcess arrivals)
+{
+    Scenario scenario;
+    scenario.counters = scale;
+    scenario.dining_tables = 5 * scale;
+    scenario.stations = scale;
+    scenario.customers = 18 * scale;
+    scenario.arrivals = arrivals;
+
+    // about 3 rows per dining row of tables and 2 per counter row
+    float area = scenario.dining_tables * 2 * 3 + (scenario.counters + scenario.stations * 6) * 1.25f * 2;
+    scenario.columns = std::max(16, int(ceilf(sqrtf(area))));
+
+    return scenario;
+}
+
+ArrivalProcess arrival_process_from_name(const std::string& name)
+{
+    if (name == "poisson") return ArrivalProcess::Poisson;
+    if (name == "bursts") return ArrivalProcess::Bursts;
+    if (name == "rush") return ArrivalProcess::RushHour;
+    return ArrivalProcess::Even;
+}
+
+int scenario_customer_count(const Scenario& scenario)
+{
+    return std::max(1, int(roundf(scenario.customers * scenario.intensity)));
+}
+
+// Waits between consecutive arrivals (one less than the number of customers)
+std::vector<float> generate_arrival_gaps(const Scenario& scenario, std::mt19937& rng)
+{
+    int count = scenario_customer_count(scenario);
+    float rate = count / scenario.day_length;
+
+    std::vector<float> gaps;
+    gaps.reserve(count);
+
+    if (scenario.arrivals == ArrivalProcess::Even)
+    {
+        gaps.assign(count - 1, scenario.day_length / count);
+    }
+    else if (scenario.arrivals == ArrivalProcess::Poisson)
+    {
+        std::exponential_distribution<float> gap(rate);
+        for (int i = 1; i < count; i++)
+            gaps.push_back(gap(rng));
+    }
+    else if (scenario.arrivals == ArrivalProcess::Bursts)
+    {
+        // bursts come at a Poisson rate, and everyone in a burst walks in a few ticks apart
+        std::exponential_distribution<float> burst_gap(rate / scenario.burst_size);
+        std::poisson_distribution<int> extra(std::max(scenario.burst_size - 1.0f, 0.0f));
+
+        int left_in_burst = 1 + extra(rng);
+        for (int i = 1; i < count; i++)
+        {
+            if (--left_in_burst > 0)
+            {
+                gaps.push_back(TIMESTEP * 3);
+                continue;
+            }
+
+            gaps.push_back(burst_gap(rng));
+            left_in_burst = 1 + extra(rng);
+        }
+    }
+    else
+    {
+        // rate(t) = base * (1 + (peak - 1) * bell around the middle of the day), drawn by thinning
+        float center = scenario.day_length / 2;
+        float width = scenario.day_length / 8;
+        float bell_area = width * sqrtf(2 * PI);
+        float base = count / (scenario.day_length + (scenario.rush_peak - 1) * bell_area);
+        float highest = base * std::max(scenario.rush_peak, 1.0f);
+
+        std::exponential_distribution<float> candidate(highest);
+        std::uniform_real_distribution<float> accept(0.0f, 1.0f);
+
+        float time = 0;
+        float last_arrival = 0;
+        for (int arrived = 0; arrived < count;)
+        {
+            time += candidate(rng);
+
+            float offset = (time - center) / width;
+            float rate_now = base * (1 + (scenario.rush_peak - 1) * expf(-0.5f * offset * offset));
+
+            if (accept(rng) * highest > rate_now) continue;
+
+            if (arrived > 0)
+                gaps.push_back(time - last_arrival);
+
+            last_arrival = time;
+            arrived++;
+        }
+    }
+
+    return gaps;
+}
+
+// Replaces the world with the scenario's cafe.
+//
+// Layout, top to bottom: two walkway rows with the entrance in the top left corner,
+// rows of dining tables (chair, table, aisle), then rows of counters with an aisle
+// below each and a gap every few counters to walk through
+void build_scenario(CafeWorld& world, const Scenario& scenario)
+{
+    entt::registry& registry = world.registry;
+
+    registry.clear();
+    reset_day_memory(world);
+    world.customers_so_far = 0;
+    world.customers_not_served = 0;
+    world.day_score = 0;
+    world.button_name = "";
+    world.rng.seed(scenario.seed);
+
+    int columns = std::max(scenario.columns, 6);
+
+    int tables_per_row = std::max((columns - 2) / 2, 1);
+    int dining_rows = (scenario.dining_tables + tables_per_row - 1) / tables_per_row;
+
+    // counter slots in a row, skipping every fifth tile so people can get through
+    std::vector<int> counter_slots;
+    for (int x = 1; x < columns - 1; x++)
+    {
+        if (x % 5 != 0)
+            counter_slots.push_back(x);
+    }
+
+    int station_counters = scenario.stations * 6;
+    int total_counters = station_counters + scenario.counters;
+    int counter_rows = std::max((total_counters + int(counter_slots.size()) - 1) / int(counter_slots.size()), 1);
+
+    int kitchen_start = 2 + dining_rows * 3 + 1;
+    int rows = kitchen_start + counter_rows * 2 + 1;
+
+    world.navigation.Resize(columns, rows, GRID_SIZE);
+
+    auto tile_center = [](int x, int y) {
+        return Vector2{(x + 0.5f) * GRID_SIZE, (y + 0.5f) * GRID_SIZE};
+    };
+
+    create_player(world, tile_center(columns / 2, kitchen_start + 1));
+    create_spawn_timer(world);
+
+    // counters, stations first
+    std::vector<entt::entity> counters;
+    for (int i = 0; i < total_counters; i++)
+    {
+        int x = counter_slots[i % counter_slots.size()];
+        int y = kitchen_start + (i / int(counter_slots.size())) * 2;
+
+        counters.push_back(create_counter(world, tile_center(x, y), i >= station_counters));
+    }
+
+    for (int i = 0; i < scenario.dining_tables; i++)
+    {
+        int row = i / tables_per_row;
+        int column = 1 + (i % tables_per_row) * 2;
+
+        create_dining_table(world, tile_center(column, 3 + row * 3));
+    }
+
+    for (int i = 0; i < scenario.stations; i++)
+    {
+        entt::entity* station = &counters[i * 6];
+
+        create_cup_stack(world, registry.get<PositionComponent>(station[0]).position);
+        create_coffee_machine(world, registry.get<PositionComponent>(station[1]).position);
+        create_ingredient_stack(world, registry.get<PositionComponent>(station[2]).position, "coffee bean", PINK);
+
+        create_pitcher(world, station[3], "water", SKYBLUE);
+        create_pitcher(world, station[4], "hot water", RED);
+        create_pitcher(world, station[5], "milk", WHITE);
+    }
+
+    world.total_customers_today[world.day] = float(scenario_customer_count(scenario));
+    world.arrival_gaps = generate_arrival_gaps(scenario, world.rng);
+
+    world.navigation_dirty = true;
+
+    reserve_memory(world);
+}
+
+#endif
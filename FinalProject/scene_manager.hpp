@@ -3,9 +3,15 @@
 
 #include <raylib.h>
 
+#include <chrono>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+#include "trace.hpp"
 
 class SceneManager;
 
@@ -30,6 +36,18 @@ public:
     // Draws the scene's current state
     virtual void Draw() = 0;
 
+    // Textures this scene needs in Begin. The scene manager warms these
+    // in the background so that switching to this scene does not stall
+    virtual std::vector<std::string> GetAssetManifest() {
+        return {};
+    }
+
+    // Scene IDs this scene is likely to switch to next.
+    // Their manifests get warmed while this scene is running
+    virtual std::vector<int> GetLikelySuccessors() {
+        return {};
+    }
+
     void SetSceneManager(SceneManager* scene_manager) {
         this->scene_manager = scene_manager;
     }
@@ -40,6 +58,115 @@ public:
 };
 
 
+// Resource manager implemented as a singleton
+class ResourceManager {
+    std::unordered_map<std::string, Texture> textures;
+
+    // Images being decoded on a background thread, waiting to be uploaded to the GPU.
+    // Only decoding happens off the main thread; LoadTextureFromImage needs the GL context
+    std::unordered_map<std::string, std::shared_future<Image>> pending_images;
+
+    ResourceManager() {}
+
+    void UploadImage(const std::string& path) {
+        TraceScope trace("UploadImage");
+
+        Image image = pending_images[path].get();
+        textures[path] = LoadTextureFromImage(image);
+        UnloadImage(image);
+        pending_images.erase(path);
+    }
+
+public:
+    // Delete copy constructor and copy operator (=)
+    // Ensures there will only be one instance of the resource manager
+    ResourceManager(const ResourceManager&) = delete;
+    void operator=(const ResourceManager&) = delete;
+
+    static ResourceManager* GetInstance() {
+        static ResourceManager instance;
+        return &instance;
+    }
+
+    Texture GetTexture(const std::string& path) {
+        // If the texture is still being warmed, finish it now instead of loading it twice
+        if (pending_images.find(path) != pending_images.end()) {
+            std::cout << "Waited for " << path << " to finish warming" << std::endl;
+            UploadImage(path);
+        }
+
+        // If the texture does not exist yet in our records,
+        // load it and store it in memory.
+        if (textures.find(path) == textures.end()) {
+            std::cout << "Loaded " << path << " from Disk" << std::endl;
+
+            TraceScope trace("LoadTexture");
+            textures[path] = LoadTexture(path.c_str());
+        }
+        else {
+            std::cout << "Resource Already Loaded" << std::endl;
+        }
+
+        return textures[path];
+    }
+
+    // Starts decoding the texture in the background if it is not loaded or warming yet
+    void RequestTexture(const std::string& path) {
+        if (textures.find(path) != textures.end() || pending_images.find(path) != pending_images.end()) {
+            return;
+        }
+
+        pending_images[path] = std::async(std::launch::async, [path]() {
+            trace_thread_name("asset decode");
+            TraceScope trace("LoadImage");
+            return LoadImage(path.c_str());
+        }).share();
+    }
+
+    // True if GetTexture on this path will not touch the disk
+    bool IsTextureReady(const std::string& path) {
+        return textures.find(path) != textures.end();
+    }
+
+    // Uploads decoded images to the GPU until the time budget (in seconds) runs out.
+    // At least one upload is done per call so warming always makes progress
+    void UploadPendingTextures(double budget) {
+        double start = GetTime();
+
+        std::vector<std::string> decoded;
+        for (auto& it : pending_images) {
+            if (it.second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                decoded.push_back(it.first);
+            }
+        }
+
+        for (const std::string& path : decoded) {
+            std::cout << "Warmed " << path << std::endl;
+            UploadImage(path);
+
+            if (GetTime() - start >= budget) {
+                break;
+            }
+        }
+    }
+
+    // Used for unloading all the textures when the game is closed.
+    void UnloadAllTextures() {
+        // Let any background decodes finish so their images can be freed
+        for (auto& it : pending_images) {
+            UnloadImage(it.second.get());
+        }
+
+        pending_images.clear();
+
+        for (auto it : textures) {
+            UnloadTexture(it.second);
+        }
+
+        textures.clear();
+    }
+};
+
 class SceneManager {
     // Mapping between a scene ID and a reference to the scene
     std::unordered_map<int, Scene*> scenes;
@@ -47,7 +174,44 @@ class SceneManager {
      // Current active scene
     Scene* active_scene = nullptr;
 
+    // Scene we are switching to once its assets are ready (-1 if none)
+    int pending_scene_id = -1;
+
+    // Ends the active scene and begins the new one. Assumes its assets are warm
+    void FinishSwitch(int scene_id) {
+        // If there is already an active scene, end it first
+        if (active_scene != nullptr) {
+            TraceScope trace("Scene::End");
+            active_scene->End();
+        }
+
+        std::cout << "Moved to Scene " << scene_id << std::endl;
+
+        active_scene = scenes[scene_id];
+
+        {
+            TraceScope trace("Scene::Begin");
+            active_scene->Begin();
+        }
+
+        // Warm whatever the new scene is likely to switch to next
+        for (int successor : active_scene->GetLikelySuccessors()) {
+            WarmScene(successor);
+        }
+    }
+
 public:
+    // Seconds per frame that may be spent uploading warmed textures to the GPU
+    double upload_budget = 0.004;
+
+    // Called every frame while a switch is waiting on assets, with progress from 0 to 1.
+    // Draws a simple loading bar by default
+    std::function<void(float)> loading_hook = [](float progress) {
+        DrawText("Loading...", 330, 260, 30, BLACK);
+        DrawRectangle(250, 310, 300, 20, Color{254, 250, 224, 255});
+        DrawRectangle(250, 310, int(300 * progress), 20, Color{96, 108, 56, 255});
+    };
+
     // Adds the specified scene to the scene manager, and assigns it
     // to the specified scene ID
     void RegisterScene(Scene* scene, int scene_id) {
@@ -60,73 +224,86 @@ public:
         scenes.erase(scene_id);
     }
 
-    // Switches to the scene identified by the specified scene ID.
-    void SwitchScene(int scene_id) {
-        // If the scene ID does not exist in our records,
-        // don't do anything (or you can print an error message).
+    // Starts warming the assets of the scene identified by the specified scene ID
+    void WarmScene(int scene_id) {
         if (scenes.find(scene_id) == scenes.end()) {
-            std::cout << "Scene ID not found" << std::endl;
             return;
         }
 
-        // If there is already an active scene, end it first
-        if (active_scene != nullptr) {
-            active_scene->End();
+        for (const std::string& path : scenes[scene_id]->GetAssetManifest()) {
+            ResourceManager::GetInstance()->RequestTexture(path);
         }
+    }
 
-        std::cout << "Moved to Scene " << scene_id << std::endl;
+    // Fraction of the scene's manifest that is already uploaded
+    float GetLoadingProgress(int scene_id) {
+        std::vector<std::string> manifest = scenes[scene_id]->GetAssetManifest();
+        if (manifest.empty()) {
+            return 1.0f;
+        }
 
-        active_scene = scenes[scene_id];
+        int ready = 0;
+        for (const std::string& path : manifest) {
+            if (ResourceManager::GetInstance()->IsTextureReady(path)) {
+                ready++;
+            }
+        }
 
-        active_scene->Begin();
+        return ready / float(manifest.size());
     }
 
-    // Gets the active scene
-    Scene* GetActiveScene() {
-        return active_scene;
-    }
-};
-
-// Resource manager implemented as a singleton
-class ResourceManager {
-    std::unordered_map<std::string, Texture> textures;
+    // Switches to the scene identified by the specified scene ID.
+    // If its assets are not warm yet, the switch is finished by Update once they are
+    void SwitchScene(int scene_id) {
+        // If the scene ID does not exist in our records,
+        // don't do anything (or you can print an error message).
+        if (scenes.find(scene_id) == scenes.end()) {
+            std::cout << "Scene ID not found" << std::endl;
+            return;
+        }
 
-    ResourceManager() {}
+        WarmScene(scene_id);
 
-public:
-    // Delete copy constructor and copy operator (=)
-    // Ensures there will only be one instance of the resource manager
-    ResourceManager(const ResourceManager&) = delete;
-    void operator=(const ResourceManager&) = delete;
+        if (GetLoadingProgress(scene_id) < 1.0f) {
+            std::cout << "Waiting on assets for Scene " << scene_id << std::endl;
+            pending_scene_id = scene_id;
+            return;
+        }
 
-    static ResourceManager* GetInstance() {
-        static ResourceManager instance;
-        return &instance;
+        pending_scene_id = -1;
+        FinishSwitch(scene_id);
     }
 
-    Texture GetTexture(const std::string& path) {
-        // If the texture does not exist yet in our records,
-        // load it and store it in memory.
-        if (textures.find(path) == textures.end()) {
-            std::cout << "Loaded " << path << " from Disk" << std::endl;
-            textures[path] = LoadTexture(path.c_str());
-        }
-        else {
-            std::cout << "Resource Already Loaded" << std::endl;
+    // Uploads warmed assets within the frame budget, and finishes a pending switch
+    // once its assets are ready. Call once per frame before updating the active scene
+    void Update() {
+        TraceScope trace("SceneManager::Update");
+
+        ResourceManager::GetInstance()->UploadPendingTextures(upload_budget);
+
+        if (pending_scene_id != -1 && GetLoadingProgress(pending_scene_id) >= 1.0f) {
+            int scene_id = pending_scene_id;
+            pending_scene_id = -1;
+            FinishSwitch(scene_id);
         }
+    }
 
-        return textures[path];
+    // True while a switch is waiting on assets
+    bool IsSwitching() {
+        return pending_scene_id != -1;
     }
 
-    // Used for unloading all the textures when the game is closed.
-    void UnloadAllTextures() {
-        for (auto it : textures) {
-            UnloadTexture(it.second);
+    // Draws the loading hook for the pending switch
+    void DrawLoading() {
+        if (pending_scene_id != -1 && loading_hook) {
+            loading_hook(GetLoadingProgress(pending_scene_id));
         }
+    }
 
-        textures.clear();
+    // Gets the active scene
+    Scene* GetActiveScene() {
+        return active_scene;
     }
 };
 
-
 #endif
\ No newline at end of file
@@ -0,0 +1,198 @@
+#ifndef SIMULATION_THREAD
+#define SIMULATION_THREAD
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "fixed_step.hpp"
+#include "input_events.hpp"
+#include "render_state.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
+
+// Runs the fixed-step simulation of a world on its own thread, so a slow frame
+// does not hold up ticks and a slow tick does not hold up drawing.
+//
+// The main thread sends input events through a lock-free queue and draws the latest
+// RenderState from a triple buffer; it never touches the world while the thread runs.
+// Include after game_functions.hpp, save_state.hpp and autopilot.hpp.
+
+class SimulationThread {
+    CafeWorld& world;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    SpscQueue<InputEvent> events = SpscQueue<InputEvent>(256);
+    TripleBuffer<RenderState> render_states;
+
+    // set by the main thread
+    std::atomic<bool> autopilot_enabled{false};
+    std::atomic<float> time_warp{1.0f};
+    std::atomic<bool> memory_overlay{false};
+
+    // only used by the simulation thread while it runs
+    FixedStep clock = FixedStep(TIMESTEP);
+    Autopilot autopilot;
+    InputTimeline timeline;
+    bool autopilot_was_enabled = false;
+    bool was_falling_behind = false;
+
+    void Publish() {
+        TraceScope trace("Publish");
+
+        RenderState& state = render_states.WriteBuffer();
+        capture_render_state(world, state);
+
+        state.autopilot = autopilot_was_enabled;
+        state.time_warp = time_warp.load(std::memory_order_relaxed);
+        state.time_dilation = clock.TimeDilation();
+        state.falling_behind = clock.FallingBehind();
+
+        state.show_memory = memory_overlay.load(std::memory_order_relaxed);
+        if (state.show_memory)
+            inspect_memory(world, state.memory);
+
+        state.alpha = clock.Alpha();
+        state.captured_at = input_time();
+
+        render_states.Publish();
+    }
+
+    void Run() {
+        trace_thread_name("simulation");
+
+        double last = input_time();
+
+        while (running.load(std::memory_order_acquire))
+        {
+            TraceScope loop_trace("simulation loop");
+
+            InputEvent event;
+            while (events.Pop(event))
+                timeline.Add(event);
+
+            bool use_autopilot = autopilot_enabled.load(std::memory_order_relaxed);
+            if (use_autopilot != autopilot_was_enabled)
+            {
+                autopilot.Reset();
+                autopilot_was_enabled = use_autopilot;
+            }
+
+            float warp = time_warp.load(std::memory_order_relaxed);
+
+            double now = input_time();
+            float frame_time = float(now - last);
+            last = now;
+
+            // Physics Step, with a bounded number of catch-up ticks
+            int ticks = clock.Advance(frame_time, warp);
+            for (int tick = 0; tick < ticks; tick++)
+            {
+                TraceScope tick_trace("tick");
+
+                // the real time this tick stands for ends here, the ticks after it and
+                // whatever is left in the accumulator come later
+                double tick_end = now - (clock.Leftover() + (ticks - 1 - tick) * TIMESTEP) / warp;
+                PlayerInput input = player_input_from(timeline.FrameUntil(tick_end));
+
+                // the autopilot decides every tick, so time warp does not make it overshoot
+                if (use_autopilot)
+                    input = autopilot.Think(world);
+
+                apply_player_input(world, input);
+                simulate_tick(world);
+            }
+
+            // autosave only while the day is still going
+            if (world.button_name == "")
+            {
+                TraceScope trace("autosave");
+                autosave.Update(world, frame_time);
+            }
+
+            if (clock.FallingBehind() != was_falling_behind)
+            {
+                was_falling_behind = clock.FallingBehind();
+                if (was_falling_behind)
+                    std::cout << "Simulation falling behind, running at " << int(clock.TimeDilation() * 100) << "% speed" << std::endl;
+                else
+                    std::cout << "Simulation caught up, " << clock.dropped_time << "s skipped so far" << std::endl;
+            }
+
+            if (ticks > 0)
+                Publish();
+
+            float wait = clock.TimeToNextTick() / std::max(warp, 1.0f);
+
+            TraceScope sleep_trace("sleep");
+            std::this_thread::sleep_for(std::chrono::duration<float>(wait));
+        }
+    }
+
+public:
+    SimulationThread(CafeWorld& world) : world(world) {}
+
+    ~SimulationThread() {
+        Stop();
+    }
+
+    // Starts ticking the world. Nothing else may touch the world until Stop
+    void Start() {
+        Stop();
+
+        clock.Reset();
+        autopilot.Reset();
+        events.Clear();
+        timeline.Reset();
+        autopilot_was_enabled = autopilot_enabled.load();
+        was_falling_behind = false;
+
+        // so there is something to draw before the first tick
+        Publish();
+
+        running.store(true, std::memory_order_release);
+        thread = std::thread(&SimulationThread::Run, this);
+    }
+
+    // Stops ticking after the current batch of ticks. The world is the caller's again afterwards
+    void Stop() {
+        running.store(false, std::memory_order_release);
+
+        if (thread.joinable())
+            thread.join();
+    }
+
+    // Main thread. Returns false if the simulation is too far behind to take more input
+    bool Send(const InputEvent& event) {
+        return events.Push(event);
+    }
+
+    // Main thread
+    void SetAutopilot(bool enabled, float warp) {
+        autopilot_enabled.store(enabled, std::memory_order_relaxed);
+        time_warp.store(std::max(warp, 1.0f), std::memory_order_relaxed);
+    }
+
+    // Main thread. Whether published states carry a memory report
+    void SetMemoryOverlay(bool enabled) {
+        memory_overlay.store(enabled, std::memory_order_relaxed);
+    }
+
+    // Main thread. The newest state the simulation has published
+    const RenderState& Latest() {
+        render_states.Update();
+        return render_states.Read();
+    }
+
+    // Main thread. How far past the state's last tick the simulation is by now, from 0 to 1
+    float Alpha(const RenderState& state) const {
+        float elapsed = float(input_time() - state.captured_at) * state.time_warp;
+        return std::min(state.alpha + elapsed / TIMESTEP, 1.0f);
+    }
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef SOUND_EFFECTS
+#define SOUND_EFFECTS
+
+#include <raylib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Sound effects, mixed in software on the audio thread (audio_thread.hpp).
+//
+// Every effect is decoded once into one shared buffer of samples before the game
+// starts, and a fixed number of voices play out of it. Firing an effect only queues
+// its id, so nothing touches the disk or allocates while the game runs. When every
+// voice is busy the new effect takes over the least important one, or is dropped if
+// all of them matter more.
+
+enum SoundEffect
+{
+    SFX_ESPRESSO_READY,
+    SFX_PAYMENT,
+    SFX_CUSTOMER_LEAVING,
+    SFX_COUNT
+};
+
+struct SoundEffectInfo
+{
+    const char* path;       // used if the file is there
+    int priority;           // higher takes over voices from lower
+
+    // tone played instead when there is no file: a sweep from start_hz to end_hz that fades out
+    float start_hz;
+    float end_hz;
+    float seconds;
+};
+
+const SoundEffectInfo sound_effect_info[SFX_COUNT] = {
+    {"espresso_ready.wav", 2, 880.0f, 1320.0f, 0.35f},
+    {"payment.wav", 3, 1568.0f, 2093.0f, 0.25f},
+    {"customer_leaving.wav", 1, 440.0f, 220.0f, 0.4f},
+};
+
+// Samples of every effect back to back, 16-bit mono
+class SamplePool {
+    struct Range
+    {
+        size_t offset;
+        size_t frames;
+    };
+
+    std::vector<int16_t> samples;
+    Range ranges[SFX_COUNT] = {};
+
+    void Synthesize(const SoundEffectInfo& info) {
+        size_t frames = size_t(info.seconds * SAMPLE_RATE);
+        float phase = 0.0f;
+
+        for (size_t i = 0; i < frames; i++)
+        {
+            float t = float(i) / frames;
+            float hz = info.start_hz + (info.end_hz - info.start_hz) * t;
+
+            phase += 2.0f * PI * hz / SAMPLE_RATE;
+            float fade = expf(-4.0f * t) * std::min(i / 64.0f, 1.0f);
+
+            samples.push_back(int16_t(sinf(phase) * fade * 12000.0f));
+        }
+    }
+
+public:
+    static constexpr int SAMPLE_RATE = 44100;
+
+    // Decodes every effect into the pool. Call before the audio thread gets the pool
+    void Load() {
+        samples.clear();
+
+        for (int effect = 0; effect < SFX_COUNT; effect++)
+        {
+            const SoundEffectInfo& info = sound_effect_info[effect];
+            ranges[effect].offset = samples.size();
+
+            Wave wave = FileExists(info.path) ? LoadWave(info.path) : Wave{};
+            if (IsWaveReady(wave))
+            {
+                WaveFormat(&wave, SAMPLE_RATE, 16, 1);
+
+                const int16_t* data = (const int16_t*)wave.data;
+                samples.insert(samples.end(), data, data + wave.frameCount);
+
+                UnloadWave(wave);
+            }
+            else
+            {
+                Synthesize(info);
+            }
+
+            ranges[effect].frames = samples.size() - ranges[effect].offset;
+        }
+    }
+
+    const int16_t* Samples(SoundEffect effect) const {
+        return samples.data() + ranges[effect].offset;
+    }
+
+    size_t Frames(SoundEffect effect) const {
+        return ranges[effect].frames;
+    }
+};
+
+// The effects playing right now, mixed into one stream
+class VoicePool {
+public:
+    static constexpr int MAX_VOICES = 8;
+
+private:
+    struct Voice
+    {
+        bool active = false;
+        SoundEffect effect = SFX_ESPRESSO_READY;
+        size_t position = 0;        // next frame to play
+    };
+
+    Voice voices[MAX_VOICES];
+
+public:
+    // Starts the effect on a free voice, or on the voice playing the least important
+    // effect (the one furthest along among equals). Returns false if every voice
+    // is playing something more important
+    bool Start(SoundEffect effect) {
+        Voice* chosen = nullptr;
+
+        for (Voice& voice : voices)
+        {
+            if (!voice.active)
+            {
+                chosen = &voice;
+                break;
+            }
+
+            int priority = sound_effect_info[voice.effect].priority;
+            if (priority > sound_effect_info[effect].priority) continue;
+
+            if (!chosen || priority < sound_effect_info[chosen->effect].priority ||
+                (priority == sound_effect_info[chosen->effect].priority && voice.position > chosen->position))
+                chosen = &voice;
+        }
+
+        if (!chosen) return false;
+
+        chosen->active = true;
+        chosen->effect = effect;
+        chosen->position = 0;
+        return true;
+    }
+
+    // Adds the next frames of every voice together into out, silence if nothing plays
+    void Mix(const SamplePool& pool, int16_t* out, size_t frames) {
+        for (size_t i = 0; i < frames; i++)
+        {
+            int32_t sum = 0;
+
+            for (Voice& voice : voices)
+            {
+                if (!voice.active) continue;
+
+                sum += pool.Samples(voice.effect)[voice.position++];
+                if (voice.position == pool.Frames(voice.effect))
+                    voice.active = false;
+            }
+
+            out[i] = int16_t(std::clamp(sum, int32_t(INT16_MIN), int32_t(INT16_MAX)));
+        }
+    }
+
+    int Playing() const {
+        int playing = 0;
+        for (const Voice& voice : voices)
+            playing += voice.active;
+        return playing;
+    }
+};
+
+#endif
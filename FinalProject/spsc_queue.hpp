@@ -0,0 +1,61 @@
+#ifndef SPSC_QUEUE
+#define SPSC_QUEUE
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// A ring buffer where the producer only writes tail and the consumer only writes head,
+// so neither ever waits on the other. Push fails instead of blocking when it is full.
+template <typename T>
+class SpscQueue {
+    std::vector<T> slots;
+    size_t mask;
+
+    // kept on separate cache lines so the two threads do not keep stealing each other's line
+    alignas(64) std::atomic<size_t> head{0};    // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0};    // next slot to push, written by the producer
+
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size *= 2;
+
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    void operator=(const SpscQueue&) = delete;
+
+    // Producer only. Returns false if the queue is full
+    bool Push(const T& value) {
+        size_t back = tail.load(std::memory_order_relaxed);
+        if (back - head.load(std::memory_order_acquire) == slots.size())
+            return false;
+
+        slots[back & mask] = value;
+        tail.store(back + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty
+    bool Pop(T& value) {
+        size_t front = head.load(std::memory_order_relaxed);
+        if (front == tail.load(std::memory_order_acquire))
+            return false;
+
+        value = slots[front & mask];
+        head.store(front + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Drops everything queued
+    void Clear() {
+        head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+};
+
+#endif
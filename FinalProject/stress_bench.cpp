@@ -0,0 +1,235 @@
+/**
+ * Stress benchmark
+ *
+ * Builds synthetic cafes (scenario.hpp) at several multiples of today's size,
+ * runs the simulation for a while and reports the time spent in every system.
+ * With --threads the systems run through the tick scheduler on that many threads,
+ * and only whole ticks are timed.
+ *
+ * Built with -DTRACK_ALLOCATIONS it also reports the heap allocations and bytes of
+ * every system per tick, leaving out the first --warmup seconds while containers
+ * grow to size. With --alloc-budget N the run fails if any tick after the warm-up
+ * allocates more than N times.
+ *
+ * With --trace the whole run is traced and written out as Chrome trace JSON (trace.hpp).
+ *
+ * Usage: stress_bench [--scales 1,10,100,1000] [--seconds S] [--arrivals even|poisson|bursts|rush]
+ *                     [--intensity X] [--seed S] [--threads N] [--out bench.csv]
+ *                     [--warmup S] [--alloc-budget N] [--trace trace.json]
+ */
+
+#include <raylib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "scene_manager.hpp"
+#include "ui.hpp"
+#include "game_functions.hpp"
+#include "scenario.hpp"
+#include "tick_scheduler.hpp"
+
+int main(int argc, char** argv)
+{
+    std::vector<int> scales = {1, 10, 100, 1000};
+    float seconds = 60.0f;
+    std::string arrivals = "poisson";
+    float intensity = 1.0f;
+    unsigned seed = 1;
+    int threads = 0;
+    std::string out_path = "";
+    float warmup = 5.0f;
+    long alloc_budget = -1;
+    std::string trace_path = "";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--scales") == 0 && i + 1 < argc)
+        {
+            scales.clear();
+
+            std::stringstream list(argv[++i]);
+            std::string scale;
+            while (std::getline(list, scale, ','))
+                scales.push_back(atoi(scale.c_str()));
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--arrivals") == 0 && i + 1 < argc)
+            arrivals = argv[++i];
+        else if (strcmp(argv[i], "--intensity") == 0 && i + 1 < argc)
+            intensity = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = unsigned(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out_path = argv[++i];
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            warmup = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--alloc-budget") == 0 && i + 1 < argc)
+            alloc_budget = atol(argv[++i]);
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            trace_path = argv[++i];
+        else
+        {
+            std::cout << "Usage: " << argv[0] << " [--scales 1,10,100,1000] [--seconds S]"
+                      << " [--arrivals even|poisson|bursts|rush] [--intensity X] [--seed S] [--threads N] [--out bench.csv]"
+                      << " [--warmup S] [--alloc-budget N] [--trace trace.json]" << std::endl;
+            return 1;
+        }
+    }
+
+    // a budget nobody checks must not pass
+    if (alloc_budget >= 0 && !tracking_allocations)
+    {
+        std::cout << "Allocation budget needs a build with -DTRACK_ALLOCATIONS" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<TickScheduler> scheduler;
+    if (threads > 0)
+    {
+        pool = std::make_unique<ThreadPool>(threads);
+        scheduler = std::make_unique<TickScheduler>(*pool);
+    }
+
+    std::ofstream file;
+    if (out_path != "") file.open(out_path);
+    std::ostream& out = out_path != "" ? file : std::cout;
+
+    out << "scale,columns,rows,entities,customers_arrived,ticks";
+    for (const TickSystem& system : tick_systems)
+        out << ',' << system.name << "_us";
+    out << ",tick_us,max_tick_us,flow_fields_built";
+    if (tracking_allocations)
+    {
+        for (const TickSystem& system : tick_systems)
+            out << ',' << system.name << "_allocs," << system.name << "_alloc_bytes";
+        out << ",allocs_per_tick,alloc_bytes_per_tick,max_tick_allocs";
+    }
+    out << '\n';
+
+    bool over_budget = false;
+
+    trace_thread_name("main");
+    if (trace_path != "") start_tracing();
+
+    for (int scale : scales)
+    {
+        Scenario scenario = scaled_scenario(scale, arrival_process_from_name(arrivals));
+        scenario.intensity = intensity;
+        scenario.seed = seed;
+
+        // a world this size does not belong on the stack
+        std::unique_ptr<CafeWorld> world = std::make_unique<CafeWorld>();
+        world->verbose = false;
+
+        build_scenario(*world, scenario);
+
+        long ticks = long(seconds / TIMESTEP);
+        std::vector<double> system_us(tick_systems.size(), 0.0);
+        double max_tick_us = 0;
+        double total_us = 0;
+
+        long warmup_ticks = std::min(long(warmup / TIMESTEP), ticks);
+        std::vector<AllocationCount> system_allocs(tick_systems.size(), AllocationCount{0, 0});
+        std::vector<AllocationCount> last_allocs(tick_systems.size(), AllocationCount{0, 0});
+        uint64_t max_tick_allocs = 0;
+
+        for (long tick = 0; tick < ticks; tick++)
+        {
+            double tick_us = 0;
+            TraceScope trace("tick");
+
+            for (size_t i = 0; tracking_allocations && i < tick_systems.size(); i++)
+                last_allocs[i] = allocations_in(tick_systems[i].name);
+
+            if (scheduler)
+            {
+                auto start = std::chrono::steady_clock::now();
+                scheduler->Run(*world);
+                tick_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            }
+            else
+            {
+                for (size_t i = 0; i < tick_systems.size(); i++)
+                {
+                    AllocationScope scope(tick_systems[i].name);
+                    TraceScope trace(tick_systems[i].name);
+
+                    auto start = std::chrono::steady_clock::now();
+                    tick_systems[i].run(*world);
+                    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+                    system_us[i] += us;
+                    tick_us += us;
+                }
+            }
+
+            total_us += tick_us;
+            if (tick_us > max_tick_us) max_tick_us = tick_us;
+
+            if (!tracking_allocations || tick < warmup_ticks) continue;
+
+            uint64_t tick_allocs = 0;
+            for (size_t i = 0; i < tick_systems.size(); i++)
+            {
+                AllocationCount now = allocations_in(tick_systems[i].name);
+                system_allocs[i].allocations += now.allocations - last_allocs[i].allocations;
+                system_allocs[i].bytes += now.bytes - last_allocs[i].bytes;
+                tick_allocs += now.allocations - last_allocs[i].allocations;
+            }
+
+            if (tick_allocs > max_tick_allocs) max_tick_allocs = tick_allocs;
+
+            if (alloc_budget >= 0 && tick_allocs > uint64_t(alloc_budget) && !over_budget)
+            {
+                std::cout << "Allocation budget exceeded at scale " << scale << ", tick " << tick
+                          << ": " << tick_allocs << " allocations (budget " << alloc_budget << ")" << std::endl;
+                over_budget = true;
+            }
+        }
+
+        out << scale << ',' << world->navigation.GetColumns() << ',' << world->navigation.GetRows() << ','
+            << world->registry.storage<PositionComponent>().size() << ','
+            << world->customers_so_far << ',' << ticks;
+        // systems overlap on the scheduler, so there is no time per system
+        for (double us : system_us)
+        {
+            out << ',';
+            if (!scheduler) out << us / ticks;
+        }
+        out << ',' << total_us / ticks << ',' << max_tick_us << ',' << world->navigation.fields_built;
+
+        if (tracking_allocations)
+        {
+            long measured = std::max(ticks - warmup_ticks, 1L);
+            AllocationCount total = {0, 0};
+
+            for (const AllocationCount& allocs : system_allocs)
+            {
+                out << ',' << double(allocs.allocations) / measured << ',' << double(allocs.bytes) / measured;
+                total.allocations += allocs.allocations;
+                total.bytes += allocs.bytes;
+            }
+
+            out << ',' << double(total.allocations) / measured << ',' << double(total.bytes) / measured
+                << ',' << max_tick_allocs;
+        }
+        out << std::endl;
+    }
+
+    if (trace_path != "") stop_tracing(trace_path);
+
+    return over_budget ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+#ifndef THREAD_POOL
+#define THREAD_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trace.hpp"
+
+// Work-stealing thread pool.
+// Every worker has its own task deque. A worker takes its newest task first
+// (good for cache), and when it runs dry it steals the oldest task from another worker.
+class ThreadPool {
+    struct Worker
+    {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::atomic<size_t> queued{0};      // tasks sitting in deques
+    std::atomic<size_t> pending{0};     // tasks submitted but not finished
+    std::atomic<size_t> next_worker{0};
+    std::atomic<bool> stopping{false};
+
+    std::mutex sleep_mutex;
+    std::condition_variable work_ready;
+    std::condition_variable all_done;
+
+    struct CurrentWorkerInfo
+    {
+        const ThreadPool* pool = nullptr;
+        int index = -1;
+    };
+
+    // pool and index of the worker running on this thread, shared by every pool
+    static CurrentWorkerInfo& CurrentWorker() {
+        thread_local CurrentWorkerInfo current;
+        return current;
+    }
+
+    bool PopOwn(size_t index, std::function<void()>& task) {
+        Worker& worker = *workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+
+        if (worker.tasks.empty()) return false;
+
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    bool Steal(size_t thief, std::function<void()>& task) {
+        for (size_t i = 1; i < workers.size(); i++)
+        {
+            Worker& victim = *workers[(thief + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+
+            if (victim.tasks.empty()) continue;
+
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+
+        return false;
+    }
+
+    void Run(std::function<void()>& task) {
+        queued--;
+        task();
+
+        if (--pending == 0)
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            all_done.notify_all();
+        }
+    }
+
+    void WorkerLoop(size_t index) {
+        CurrentWorker() = {this, int(index)};
+        trace_thread_name("worker");
+
+        std::function<void()> task;
+        while (true)
+        {
+            if (PopOwn(index, task) || Steal(index, task))
+            {
+                Run(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            work_ready.wait(lock, [this]() { return stopping || queued > 0; });
+
+            if (stopping && queued == 0) return;
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t count = std::thread::hardware_concurrency()) {
+        if (count == 0) count = 1;
+
+        for (size_t i = 0; i < count; i++)
+            workers.push_back(std::make_unique<Worker>());
+
+        for (size_t i = 0; i < count; i++)
+            threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        work_ready.notify_all();
+
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    void operator=(const ThreadPool&) = delete;
+
+    size_t Size() const {
+        return workers.size();
+    }
+
+    // Queues a task. Tasks submitted from inside the pool go to the submitting
+    // worker's own deque, everything else (other pools' workers too) is spread round robin
+    void Submit(std::function<void()> task) {
+        const CurrentWorkerInfo& current = CurrentWorker();
+        size_t index = current.pool == this ? size_t(current.index) : next_worker++ % workers.size();
+
+        // counted before the task can be seen, so a thief running it at once never takes them below zero
+        pending++;
+        queued++;
+        {
+            std::lock_guard<std::mutex> lock(workers[index]->mutex);
+            workers[index]->tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        work_ready.notify_one();
+    }
+
+    // Blocks until every submitted task has finished.
+    // Only call this from outside the pool
+    void Wait() {
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        all_done.wait(lock, [this]() { return pending == 0; });
+    }
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef TICK_SCHEDULER
+#define TICK_SCHEDULER
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+// Runs the systems of a tick on a thread pool, as many at a time as their
+// SystemAccess allows.
+//
+// The job graph is built once: every system waits for the earlier systems it conflicts
+// with (one writes what the other reads or writes, or either is exclusive), so a tick
+// ends exactly the way it would running the systems one after another. Splittable
+// systems with enough work are cut into chunks that run in parallel too.
+// Include after game_functions.hpp.
+
+// Makes sure every component has its storage. Views create missing storages,
+// which must not happen on two threads at once
+template <typename... T>
+void create_storages(entt::registry& registry, std::tuple<T...>*)
+{
+    ((void)registry.storage<T>(), ...);
+}
+
+class TickScheduler {
+    ThreadPool& pool;
+    const std::vector<TickSystem>& systems;
+    size_t chunk_size;
+
+    std::vector<std::vector<size_t>> dependents;    // systems waiting for each system
+    std::vector<int> dependencies;                  // how many systems each one waits for
+    std::vector<size_t> roots;                      // systems that wait for nothing
+
+    // the tick being run
+    CafeWorld* world = nullptr;
+    std::unique_ptr<std::atomic<int>[]> waiting;
+    std::unique_ptr<std::atomic<size_t>[]> chunks_left;
+
+    static bool Conflict(const SystemAccess& a, const SystemAccess& b) {
+        if (a.exclusive || b.exclusive) return true;
+        return (a.writes & (b.reads | b.writes)) || (b.writes & a.reads);
+    }
+
+    void Finish(size_t index) {
+        for (size_t next : dependents[index])
+        {
+            if (--waiting[next] == 0)
+                Launch(next);
+        }
+    }
+
+    void Launch(size_t index) {
+        const TickSystem& system = systems[index];
+        size_t count = system.count ? system.count(*world) : 0;
+
+        if (count <= chunk_size)
+        {
+            pool.Submit([this, index]() {
+                {
+                    AllocationScope scope(systems[index].name);
+                    TraceScope trace(systems[index].name);
+                    systems[index].run(*world);
+                }
+                Finish(index);
+            });
+            return;
+        }
+
+        size_t chunks = (count + chunk_size - 1) / chunk_size;
+        chunks_left[index] = chunks;
+
+        for (size_t chunk = 0; chunk < chunks; chunk++)
+        {
+            size_t begin = chunk * chunk_size;
+            size_t end = std::min(begin + chunk_size, count);
+
+            pool.Submit([this, index, begin, end]() {
+                {
+                    AllocationScope scope(systems[index].name);
+                    TraceScope trace(systems[index].name);
+                    systems[index].run_range(*world, begin, end);
+                }
+
+                if (--chunks_left[index] == 0)
+                    Finish(index);
+            });
+        }
+    }
+
+public:
+    // chunk_size: how many entities a chunk of a split system gets
+    TickScheduler(ThreadPool& pool, const std::vector<TickSystem>& systems = tick_systems, size_t chunk_size = 1024)
+        : pool(pool), systems(systems), chunk_size(std::max(chunk_size, size_t(1))) {
+        dependents.resize(systems.size());
+        dependencies.assign(systems.size(), 0);
+
+        for (size_t later = 0; later < systems.size(); later++)
+        {
+            for (size_t earlier = 0; earlier < later; earlier++)
+            {
+                if (!Conflict(systems[earlier].access, systems[later].access)) continue;
+
+                dependents[earlier].push_back(later);
+                dependencies[later]++;
+            }
+
+            if (dependencies[later] == 0)
+                roots.push_back(later);
+        }
+
+        waiting = std::make_unique<std::atomic<int>[]>(systems.size());
+        chunks_left = std::make_unique<std::atomic<size_t>[]>(systems.size());
+    }
+
+    TickScheduler(const TickScheduler&) = delete;
+    void operator=(const TickScheduler&) = delete;
+
+    // One fixed step of the world, the same as simulate_tick.
+    // Only call this from outside the pool, and with nothing else using the pool
+    void Run(CafeWorld& world) {
+        this->world = &world;
+        create_storages(world.registry, (TickComponents*)nullptr);
+
+        for (size_t i = 0; i < systems.size(); i++)
+            waiting[i] = dependencies[i];
+
+        for (size_t root : roots)
+            Launch(root);
+
+        pool.Wait();
+    }
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef TILEMAP
+#define TILEMAP
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Static collision on the tile grid.
+// Counters, tables and chairs never move and each sits in the middle of a tile, so
+// instead of being collision bodies of their own they are kept as one byte per tile
+// saying what fills it. A mover only looks at the tiles it overlaps (the 3x3 around
+// it at walking speed), so static collision costs the same however much furniture
+// the cafe has.
+
+enum TileShape : uint8_t
+{
+    TILE_EMPTY,
+    TILE_QUARTER,       // a box half a tile wide in the middle of the tile (chairs)
+    TILE_FULL           // the whole tile (counters, tables)
+};
+
+class Tilemap {
+    int columns = 0;
+    int rows = 0;
+    float cell_size = 1.0f;
+
+    std::vector<uint8_t> tiles;
+
+    float HalfSizeOf(uint8_t shape) const {
+        return shape == TILE_FULL ? cell_size / 2.0f : cell_size / 4.0f;
+    }
+
+public:
+    // Empties the map and sizes it to the grid
+    void Resize(int columns, int rows, float cell_size) {
+        this->columns = columns;
+        this->rows = rows;
+        this->cell_size = cell_size;
+
+        tiles.assign(columns * rows, TILE_EMPTY);
+    }
+
+    // Fills the tile under the box. Returns false if the box is not one of the tile
+    // shapes in the middle of a tile on the grid, it has to collide some other way
+    bool Add(Vector2 center, float half_size) {
+        int x = int(floorf(center.x / cell_size));
+        int y = int(floorf(center.y / cell_size));
+        if (x < 0 || y < 0 || x >= columns || y >= rows) return false;
+
+        Vector2 tile_center = {(x + 0.5f) * cell_size, (y + 0.5f) * cell_size};
+        if (Vector2Distance(center, tile_center) > 0.01f) return false;
+
+        uint8_t shape;
+        if (fabsf(half_size - HalfSizeOf(TILE_FULL)) < 0.01f)
+            shape = TILE_FULL;
+        else if (fabsf(half_size - HalfSizeOf(TILE_QUARTER)) < 0.01f)
+            shape = TILE_QUARTER;
+        else
+            return false;
+
+        // a box inside another one (a machine on its counter) changes nothing
+        uint8_t& tile = tiles[y * columns + x];
+        tile = std::max(tile, shape);
+        return true;
+    }
+
+    // What fills the tile, empty off the grid
+    uint8_t At(int x, int y) const {
+        if (x < 0 || y < 0 || x >= columns || y >= rows) return TILE_EMPTY;
+        return tiles[y * columns + x];
+    }
+
+    // Calls f(center, half_size) with the box of every filled tile that overlaps
+    // the rectangle from min to max
+    template <typename F>
+    void ForEachBox(Vector2 min, Vector2 max, F f) const {
+        int x0 = std::max(int(floorf(min.x / cell_size)), 0);
+        int y0 = std::max(int(floorf(min.y / cell_size)), 0);
+        int x1 = std::min(int(floorf(max.x / cell_size)), columns - 1);
+        int y1 = std::min(int(floorf(max.y / cell_size)), rows - 1);
+
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                uint8_t shape = tiles[y * columns + x];
+                if (shape == TILE_EMPTY) continue;
+
+                f(Vector2{(x + 0.5f) * cell_size, (y + 0.5f) * cell_size}, HalfSizeOf(shape));
+            }
+        }
+    }
+};
+
+#endif
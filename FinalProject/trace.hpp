@@ -0,0 +1,187 @@
+#ifndef TRACE
+#define TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timeline tracing in the Chrome trace event format (open the file in
+// https://ui.perfetto.dev or chrome://tracing).
+//
+// While tracing, every TraceScope records when it started and how long it took into a
+// buffer of its own thread. Only that thread writes the buffer, only appending during a trace,
+// so recording takes no locks and the trace can be written out while other threads are
+// still recording. A thread starts its buffer over the first time it records in a new
+// trace, and when the buffer is full it stops recording for the rest of the trace.
+// Scope names must outlive the program (string literals, system names).
+
+struct TraceEvent
+{
+    const char* name;
+    int64_t start;          // nanoseconds since the program started
+    int64_t duration;
+};
+
+// Events are kept in chunks allocated as the thread needs them, so a thread that
+// records little takes up little
+class TraceBuffer {
+public:
+    static constexpr size_t CHUNK_SIZE = 4096;
+    static constexpr size_t CHUNKS = 64;
+    static constexpr size_t CAPACITY = CHUNK_SIZE * CHUNKS;
+
+    std::string thread_name;
+    std::unique_ptr<TraceEvent[]> chunks[CHUNKS];
+    // all written by the owning thread only
+    std::atomic<size_t> count{0};
+    std::atomic<size_t> dropped{0};
+    std::atomic<uint32_t> generation{0};    // trace the events belong to
+
+    TraceEvent& operator[](size_t index) {
+        return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+    }
+};
+
+std::atomic<bool> tracing{false};
+std::atomic<uint32_t> trace_generation{0};     // bumped by every start_tracing
+const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+
+// buffers of every thread that has recorded something, kept after the thread is gone
+std::mutex trace_buffers_mutex;
+std::vector<std::unique_ptr<TraceBuffer>> trace_buffers;
+
+thread_local TraceBuffer* trace_buffer = nullptr;
+thread_local const char* trace_thread = nullptr;
+
+int64_t trace_now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_epoch).count();
+}
+
+// Names the calling thread in traces. Call before it records anything
+void trace_thread_name(const char* name)
+{
+    trace_thread = name;
+}
+
+void trace_event(const char* name, int64_t start, int64_t duration)
+{
+    if (!trace_buffer)
+    {
+        std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+
+        trace_buffers.push_back(std::make_unique<TraceBuffer>());
+        trace_buffer = trace_buffers.back().get();
+        trace_buffer->thread_name = trace_thread ? trace_thread : "thread " + std::to_string(trace_buffers.size());
+    }
+
+    // the first event of a new trace starts the buffer over. The generation goes last, so
+    // a reader that sees it also sees the emptied buffer
+    uint32_t generation = trace_generation.load(std::memory_order_acquire);
+    if (trace_buffer->generation.load(std::memory_order_relaxed) != generation)
+    {
+        trace_buffer->count.store(0, std::memory_order_relaxed);
+        trace_buffer->dropped.store(0, std::memory_order_relaxed);
+        trace_buffer->generation.store(generation, std::memory_order_release);
+    }
+
+    size_t index = trace_buffer->count.load(std::memory_order_relaxed);
+    if (index == TraceBuffer::CAPACITY)
+    {
+        trace_buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::unique_ptr<TraceEvent[]>& chunk = trace_buffer->chunks[index / TraceBuffer::CHUNK_SIZE];
+    if (!chunk)
+        chunk = std::make_unique<TraceEvent[]>(TraceBuffer::CHUNK_SIZE);
+
+    (*trace_buffer)[index] = {name, start, duration};
+    trace_buffer->count.store(index + 1, std::memory_order_release);
+}
+
+// Records the time from its construction to its destruction, if tracing was on when it started
+class TraceScope {
+    const char* name;
+    int64_t start;
+
+public:
+    explicit TraceScope(const char* name) : name(name), start(tracing.load(std::memory_order_relaxed) ? trace_now() : -1) {}
+
+    ~TraceScope() {
+        if (start >= 0)
+            trace_event(name, start, trace_now() - start);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    void operator=(const TraceScope&) = delete;
+};
+
+// Starts a new trace. Whatever was recorded before is left out of it
+void start_tracing()
+{
+    trace_generation.fetch_add(1, std::memory_order_release);
+
+    tracing.store(true, std::memory_order_relaxed);
+    std::cout << "Tracing started" << std::endl;
+}
+
+// Stops tracing and writes what the current trace recorded to the file
+void stop_tracing(const std::string& path)
+{
+    tracing.store(false, std::memory_order_relaxed);
+
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "Could not write trace to " << path << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+    uint32_t generation = trace_generation.load(std::memory_order_relaxed);
+
+    size_t events = 0;
+    size_t dropped = 0;
+
+    for (size_t tid = 0; tid < trace_buffers.size(); tid++)
+    {
+        TraceBuffer& buffer = *trace_buffers[tid];
+
+        file << (tid > 0 ? ",\n" : "") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+             << ", \"args\": {\"name\": \"" << buffer.thread_name << "\"}}";
+
+        // a thread that has not recorded since the trace started still holds an older one
+        if (buffer.generation.load(std::memory_order_acquire) != generation) continue;
+
+        size_t count = buffer.count.load(std::memory_order_acquire);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const TraceEvent& event = buffer[i];
+
+            file << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+                 << ", \"ts\": " << event.start / 1000.0 << ", \"dur\": " << event.duration / 1000.0 << "}";
+        }
+
+        events += count;
+        dropped += buffer.dropped.load(std::memory_order_relaxed);
+    }
+
+    file << "\n]}" << std::endl;
+
+    std::cout << "Wrote " << events << " trace events to " << path;
+    if (dropped > 0) std::cout << " (" << dropped << " dropped, buffers full)";
+    std::cout << std::endl;
+}
+
+#endif
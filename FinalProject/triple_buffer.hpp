@@ -0,0 +1,52 @@
+#ifndef TRIPLE_BUFFER
+#define TRIPLE_BUFFER
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one writer thread to one reader thread without locks.
+//
+// The writer fills the back buffer and publishes it by swapping it with the middle one.
+// The reader swaps the middle buffer with its front buffer when something new was
+// published. Each side always owns one buffer outright, so neither ever waits, the
+// reader always sees a complete value, and values the reader was too slow for are skipped.
+template <typename T>
+class TripleBuffer {
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4;     // set on middle when the reader has not seen it yet
+
+    T buffers[3];
+
+    uint8_t back = 0;                       // writer only
+    std::atomic<uint8_t> middle{1};
+    uint8_t front = 2;                      // reader only
+
+public:
+    // Writer only. The buffer to fill; it still holds whatever was written into it before
+    T& WriteBuffer() {
+        return buffers[back];
+    }
+
+    // Writer only. Makes the write buffer the newest value
+    void Publish() {
+        uint8_t previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = previous & INDEX;
+    }
+
+    // Reader only. Moves to the newest value if there is one, returns true if it did
+    bool Update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+
+        uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX;
+        return true;
+    }
+
+    // Reader only. The value Update last moved to
+    const T& Read() const {
+        return buffers[front];
+    }
+};
+
+#endif